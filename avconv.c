@@ -91,6 +91,8 @@ static int nb_frames_drop = 0;
 #if HAVE_PTHREADS
 /* signal to input threads that they should exit; set by the main thread */
 static int transcoding_finished;
+
+static int free_output_threads(void);
 #endif
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "av2pass"
@@ -161,6 +163,10 @@ static void avconv_cleanup(int ret)
     }
     av_freep(&filtergraphs);
 
+#if HAVE_PTHREADS
+    free_output_threads();
+#endif
+
     /* close files */
     for (i = 0; i < nb_output_files; i++) {
         AVFormatContext *s = output_files[i]->ctx;
@@ -302,8 +308,88 @@ static void update_sample_fmt(AVCodecContext *dec, AVCodec *dec_codec,
     }
 }
 
+#if HAVE_PTHREADS
+static void *output_thread(void *arg)
+{
+    OutputFile *of = arg;
+    int i, ret = 0;
+
+    for (;;) {
+        AVPacket pkt;
+
+        pthread_mutex_lock(&of->fifo_lock);
+        while (!av_fifo_size(of->fifo) && !of->queue_eof)
+            pthread_cond_wait(&of->fifo_cond, &of->fifo_lock);
+        if (!av_fifo_size(of->fifo)) {
+            pthread_mutex_unlock(&of->fifo_lock);
+            break;
+        }
+        av_fifo_generic_read(of->fifo, &pkt, sizeof(pkt), NULL);
+        pthread_cond_broadcast(&of->fifo_cond);
+        pthread_mutex_unlock(&of->fifo_lock);
+
+        ret = av_interleaved_write_frame(of->ctx, &pkt);
+
+        pthread_mutex_lock(&of->fifo_lock);
+        if (of->ctx->pb)
+            of->written_size = avio_tell(of->ctx->pb);
+        for (i = 0; i < of->ctx->nb_streams; i++)
+            output_streams[of->ost_index + i]->mux_pts = of->ctx->streams[i]->pts.val;
+        if (ret < 0) {
+            of->error = ret;
+            pthread_cond_broadcast(&of->fifo_cond);
+        }
+        pthread_mutex_unlock(&of->fifo_lock);
+        if (ret < 0)
+            break;
+    }
+
+    return NULL;
+}
+
+static int queue_output_packet(OutputFile *of, OutputStream *ost, AVPacket *pkt)
+{
+    int ret;
+
+    if ((ret = av_dup_packet(pkt)) < 0) {
+        av_free_packet(pkt);
+        return ret;
+    }
+
+    pthread_mutex_lock(&of->fifo_lock);
+
+    if (of->drop_when_full) {
+        if (pkt->flags & AV_PKT_FLAG_KEY)
+            ost->drop_until_key = 0;
+        if (!av_fifo_space(of->fifo))
+            ost->drop_until_key = 1;
+    } else {
+        while (!av_fifo_space(of->fifo) && !of->error)
+            pthread_cond_wait(&of->fifo_cond, &of->fifo_lock);
+    }
+
+    if (of->error) {
+        ret = of->error;
+        av_free_packet(pkt);
+    } else if (ost->drop_until_key) {
+        of->nb_dropped++;
+        av_free_packet(pkt);
+    } else {
+        ost->data_size += pkt->size;
+        ost->packets_written++;
+        av_fifo_generic_write(of->fifo, pkt, sizeof(*pkt), NULL);
+        pthread_cond_broadcast(&of->fifo_cond);
+    }
+
+    pthread_mutex_unlock(&of->fifo_lock);
+
+    return ret;
+}
+#endif
+
 static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
 {
+    OutputFile *of = output_files[ost->file_index];
     AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
     AVCodecContext          *avctx = ost->st->codec;
     int ret;
@@ -324,18 +410,8 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
     }
 
     while (bsfc) {
-        AVPacket new_pkt = *pkt;
-        int a = av_bitstream_filter_filter(bsfc, avctx, NULL,
-                                           &new_pkt.data, &new_pkt.size,
-                                           pkt->data, pkt->size,
-                                           pkt->flags & AV_PKT_FLAG_KEY);
-        if (a > 0) {
-            av_free_packet(pkt);
-            new_pkt.buf = av_buffer_create(new_pkt.data, new_pkt.size,
-                                           av_buffer_default_free, NULL, 0);
-            if (!new_pkt.buf)
-                exit_program(1);
-        } else if (a < 0) {
+        int a = av_bitstream_filter_filter_packet(bsfc, avctx, NULL, pkt);
+        if (a < 0) {
             av_log(NULL, AV_LOG_ERROR, "%s failed for stream %d, codec %s",
                    bsfc->filter->name, pkt->stream_index,
                    avctx->codec ? avctx->codec->name : "copy");
@@ -343,7 +419,6 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
             if (exit_on_error)
                 exit_program(1);
         }
-        *pkt = new_pkt;
 
         bsfc = bsfc->next;
     }
@@ -367,11 +442,17 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
     }
     ost->last_mux_dts = pkt->dts;
 
-    ost->data_size += pkt->size;
-    ost->packets_written++;
-
     pkt->stream_index = ost->index;
-    ret = av_interleaved_write_frame(s, pkt);
+#if HAVE_PTHREADS
+    if (of->fifo) {
+        ret = queue_output_packet(of, ost, pkt);
+    } else
+#endif
+    {
+        ost->data_size += pkt->size;
+        ost->packets_written++;
+        ret = av_interleaved_write_frame(s, pkt);
+    }
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         exit_program(1);
@@ -851,6 +932,36 @@ static void print_final_stats(int64_t total_size)
     }
 }
 
+static int64_t output_file_size(OutputFile *of)
+{
+#if HAVE_PTHREADS
+    if (of->fifo) {
+        int64_t size;
+        pthread_mutex_lock(&of->fifo_lock);
+        size = of->written_size;
+        pthread_mutex_unlock(&of->fifo_lock);
+        return size;
+    }
+#endif
+    return avio_tell(of->ctx->pb);
+}
+
+/* last timestamp muxed for the stream, in its time base */
+static int64_t output_stream_pts(OutputStream *ost)
+{
+#if HAVE_PTHREADS
+    OutputFile *of = output_files[ost->file_index];
+    if (of->fifo) {
+        int64_t pts;
+        pthread_mutex_lock(&of->fifo_lock);
+        pts = ost->mux_pts;
+        pthread_mutex_unlock(&of->fifo_lock);
+        return pts;
+    }
+#endif
+    return ost->st->pts.val;
+}
+
 static void print_report(int is_last_report, int64_t timer_start)
 {
     char buf[1024];
@@ -882,8 +993,12 @@ static void print_report(int is_last_report, int64_t timer_start)
 
     oc = output_files[0]->ctx;
 
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
+#if HAVE_PTHREADS
+    if (output_files[0]->fifo)
+        total_size = output_file_size(output_files[0]);
+    else
+#endif
+    if ((total_size = avio_size(oc->pb)) <= 0) // FIXME improve avio_size() so it works with non seekable output too
         total_size = avio_tell(oc->pb);
     if (total_size < 0) {
         char errbuf[128];
@@ -946,7 +1061,7 @@ static void print_report(int is_last_report, int64_t timer_start)
             vid = 1;
         }
         /* compute min output value */
-        pts = (double)ost->st->pts.val * av_q2d(ost->st->time_base);
+        pts = (double)output_stream_pts(ost) * av_q2d(ost->st->time_base);
         if ((pts < ti1) && (pts > 0))
             ti1 = pts;
     }
@@ -2058,7 +2173,7 @@ static int need_output(void)
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
         if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+            (os->pb && output_file_size(of) >= of->limit_filesize))
             continue;
         if (ost->frame_number >= ost->max_frames) {
             int j;
@@ -2204,6 +2319,72 @@ static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 
     return ret;
 }
+/* Stop the writer threads once their queues are empty. */
+static int free_output_threads(void)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        AVPacket pkt;
+
+        if (!of->fifo)
+            continue;
+
+        if (of->thread_started) {
+            pthread_mutex_lock(&of->fifo_lock);
+            of->queue_eof = 1;
+            pthread_cond_broadcast(&of->fifo_cond);
+            pthread_mutex_unlock(&of->fifo_lock);
+
+            pthread_join(of->thread, NULL);
+            of->thread_started = 0;
+        }
+
+        if (of->error < 0) {
+            print_error(of->ctx->filename, of->error);
+            ret = of->error;
+        }
+        if (of->nb_dropped)
+            av_log(NULL, AV_LOG_WARNING, "%"PRIu64" packets dropped for "
+                   "output file #%d because its queue was full\n",
+                   of->nb_dropped, i);
+
+        while (av_fifo_size(of->fifo)) {
+            av_fifo_generic_read(of->fifo, &pkt, sizeof(pkt), NULL);
+            av_free_packet(&pkt);
+        }
+        av_fifo_free(of->fifo);
+        of->fifo = NULL;
+        pthread_mutex_destroy(&of->fifo_lock);
+        pthread_cond_destroy(&of->fifo_cond);
+    }
+
+    return ret;
+}
+
+static int init_output_threads(void)
+{
+    int i, ret;
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+
+        if (of->thread_queue_size <= 0)
+            continue;
+
+        if (!(of->fifo = av_fifo_alloc(of->thread_queue_size * sizeof(AVPacket))))
+            return AVERROR(ENOMEM);
+
+        pthread_mutex_init(&of->fifo_lock, NULL);
+        pthread_cond_init (&of->fifo_cond, NULL);
+
+        if ((ret = pthread_create(&of->thread, NULL, output_thread, of)))
+            return AVERROR(ret);
+        of->thread_started = 1;
+    }
+    return 0;
+}
 #endif
 
 static int get_input_packet(InputFile *f, AVPacket *pkt)
@@ -2406,6 +2587,8 @@ static int transcode(void)
 #if HAVE_PTHREADS
     if ((ret = init_input_threads()) < 0)
         goto fail;
+    if ((ret = init_output_threads()) < 0)
+        goto fail;
 #endif
 
     while (!received_sigterm) {
@@ -2450,6 +2633,11 @@ static int transcode(void)
 
     term_exit();
 
+#if HAVE_PTHREADS
+    if ((ret = free_output_threads()) < 0)
+        goto fail;
+#endif
+
     /* write the trailer if needed and close file */
     for (i = 0; i < nb_output_files; i++) {
         os = output_files[i]->ctx;
@@ -2484,6 +2672,7 @@ static int transcode(void)
  fail:
 #if HAVE_PTHREADS
     free_input_threads();
+    free_output_threads();
 #endif
 
     if (output_streams) {
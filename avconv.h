@@ -132,6 +132,8 @@ typedef struct OptionsContext {
     float mux_preload;
     float mux_max_delay;
     int shortest;
+    int mux_thread_queue_size;
+    int mux_queue_drop;
 
     int video_disable;
     int audio_disable;
@@ -342,6 +344,8 @@ typedef struct OutputStream {
     int stream_copy;
     const char *attachment_filename;
     int copy_initial_nonkeyframes;
+    int drop_until_key;  /* the mux queue overflowed, drop packets until the next keyframe */
+    int64_t mux_pts;     /* st->pts.val as last seen by the writer thread */
 
     enum AVPixelFormat pix_fmts[2];
 
@@ -350,7 +354,8 @@ typedef struct OutputStream {
     /* stats */
     // combined size of all the packets written
     uint64_t data_size;
-    // number of packets send to the muxer
+    // number of packets send to the muxer (not counting those dropped
+    // because the writer thread queue was full)
     uint64_t packets_written;
     // number of frames/samples sent to the encoder
     uint64_t frames_encoded;
@@ -366,6 +371,21 @@ typedef struct OutputFile {
     uint64_t limit_filesize;
 
     int shortest;
+
+    int thread_queue_size;  /* number of packets queued for the writer thread, 0 to mux from the main thread */
+    int drop_when_full;     /* drop packets instead of waiting when the queue is full */
+
+#if HAVE_PTHREADS
+    pthread_t thread;           /* thread writing to this file */
+    int thread_started;         /* the thread has been created and not joined yet */
+    int queue_eof;              /* no more packets will be queued; set by the main thread */
+    int error;                  /* muxing error returned in the writer thread */
+    int64_t written_size;       /* bytes written so far, updated by the writer thread */
+    uint64_t nb_dropped;        /* packets dropped because the queue was full */
+    pthread_mutex_t fifo_lock;  /* lock for access to fifo */
+    pthread_cond_t  fifo_cond;  /* signalled whenever a packet is queued or dequeued */
+    AVFifoBuffer *fifo;         /* packets waiting to be muxed */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -1373,6 +1373,8 @@ static int open_output_file(OptionsContext *o, const char *filename)
     of->start_time     = o->start_time;
     of->limit_filesize = o->limit_filesize;
     of->shortest       = o->shortest;
+    of->thread_queue_size = o->mux_thread_queue_size;
+    of->drop_when_full    = o->mux_queue_drop;
     av_dict_copy(&of->opts, o->g->format_opts, 0);
 
     if (!strcmp(filename, "-"))
@@ -2241,6 +2243,12 @@ const OptionDef options[] = {
     { "shortest",       OPT_BOOL | OPT_EXPERT | OPT_OFFSET |
                         OPT_OUTPUT,                                  { .off = OFFSET(shortest) },
         "finish encoding within shortest input" },
+    { "mux_thread_queue_size", HAS_ARG | OPT_INT | OPT_EXPERT | OPT_OFFSET |
+                        OPT_OUTPUT,                                  { .off = OFFSET(mux_thread_queue_size) },
+        "mux the output file in a separate thread with a packet queue of this size", "size" },
+    { "mux_queue_drop", OPT_BOOL | OPT_EXPERT | OPT_OFFSET |
+                        OPT_OUTPUT,                                  { .off = OFFSET(mux_queue_drop) },
+        "drop packets instead of waiting when the muxing thread queue is full" },
     { "dts_delta_threshold", HAS_ARG | OPT_FLOAT | OPT_EXPERT,       { &dts_delta_threshold },
         "timestamp discontinuity delta threshold", "threshold" },
     { "xerror",         OPT_BOOL | OPT_EXPERT,                       { &exit_on_error },
@@ -55,6 +55,9 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+#endif
 #include <errno.h>
 #include <time.h>
 #include <sys/wait.h>
@@ -100,6 +103,10 @@ static const char *http_state[] = {
 
 #define MAX_STREAMS 20
 
+/* number of packets kept in memory for each feed */
+#define FEED_RING_SIZE 1024
+#define FEED_RING_ENDED -2
+
 #define IOBUFFER_INIT_SIZE 8192
 
 /* timeouts are in ms */
@@ -124,6 +131,8 @@ typedef struct HTTPContext {
     int fd; /* socket file descriptor */
     struct sockaddr_in from_addr; /* origin */
     struct pollfd *poll_entry; /* used when polling */
+    int poll_events; /* events the connection is registered for (epoll) */
+    int revents; /* events returned for the connection */
     int64_t timeout;
     uint8_t *buffer_ptr, *buffer_end;
     int http_error;
@@ -137,6 +146,9 @@ typedef struct HTTPContext {
     int feed_fd;
     /* input format handling */
     AVFormatContext *fmt_in;
+    int64_t ring_pos;              /* position in the feed ring, -1 if reading
+                                      the feed file, FEED_RING_ENDED if the
+                                      ring was emptied for a new feeder */
     int64_t start_time;            /* In milliseconds - this wraps fairly often */
     int64_t first_pts;            /* initial pts value */
     int64_t cur_pts;             /* current pts value from the stream in us */
@@ -152,7 +164,7 @@ typedef struct HTTPContext {
     int feed_streams[MAX_STREAMS]; /* index of streams in the feed */
     int switch_feed_streams[MAX_STREAMS]; /* index of streams in the feed */
     int switch_pending;
-    AVFormatContext fmt_ctx; /* instance of FFStream for one user */
+    AVFormatContext *fmt_ctx; /* instance of FFStream for one user */
     int last_packet_sent; /* true if last data packet was sent */
     int suppress_log;
     DataRateData datarate;
@@ -250,6 +262,13 @@ typedef struct FFStream {
     int64_t feed_max_size;      /* maximum storage size, zero means unlimited */
     int64_t feed_write_index;   /* current write position in feed (it wraps around) */
     int64_t feed_size;          /* current size of feed */
+    /* packets recently written to the feed, shared by all its viewers */
+    AVFormatContext *ring_in;   /* reader feeding the ring */
+    AVPacket *ring;
+    int64_t *ring_time;         /* time at which each packet was received */
+    int64_t ring_start, ring_end; /* absolute packet numbers in the ring */
+    int64_t ring_open_time;     /* time from which the ring is complete */
+    int ring_failed;            /* the ring could not be opened for this feeder */
     struct FFStream *next_feed;
 } FFStream;
 
@@ -316,6 +335,9 @@ static uint64_t max_bandwidth = 1000;
 static uint64_t current_bandwidth;
 
 static int64_t cur_time;           // Making this global saves on passing it around everywhere
+#if HAVE_EPOLL_CREATE1
+static int epoll_fd = -1;
+#endif
 
 static AVLFG random_state;
 
@@ -618,19 +640,167 @@ static void start_multicast(void)
     }
 }
 
+/* return the poll events a connection is waiting for in its current state */
+static int connection_events(HTTPContext *c, int *delay)
+{
+    switch(c->state) {
+    case HTTPSTATE_SEND_HEADER:
+    case RTSPSTATE_SEND_REPLY:
+    case RTSPSTATE_SEND_PACKET:
+        return POLLOUT;
+    case HTTPSTATE_SEND_DATA_HEADER:
+    case HTTPSTATE_SEND_DATA:
+    case HTTPSTATE_SEND_DATA_TRAILER:
+        if (!c->is_packetized) {
+            /* for TCP, we output as much as we can (may need to put a limit) */
+            return POLLOUT;
+        } else {
+            /* when avserver is doing the timing, we work by
+               looking at which packet need to be sent every
+               10 ms */
+            *delay = FFMIN(*delay, 10); /* one tick wait XXX: 10 ms assumed */
+            return 0;
+        }
+    case HTTPSTATE_WAIT_REQUEST:
+    case HTTPSTATE_RECEIVE_DATA:
+    case HTTPSTATE_WAIT_FEED:
+    case RTSPSTATE_WAIT_REQUEST:
+        /* need to catch errors */
+        return POLLIN; /* Maybe this will work */
+    default:
+        return 0;
+    }
+}
+
+#if HAVE_EPOLL_CREATE1
+/* keep the epoll registration of a connection in sync with its state */
+static void update_poll_events(HTTPContext *c)
+{
+    struct epoll_event ev = { 0 };
+    int events, delay = 1000;
+
+    if (epoll_fd < 0 || c->fd < 0)
+        return;
+
+    events = connection_events(c, &delay);
+    if (events == c->poll_events)
+        return;
+
+    ev.events   = (events & POLLIN  ? EPOLLIN  : 0) |
+                  (events & POLLOUT ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    /* errors and hangups are always reported, so connections which do not
+       wait for anything are removed rather than registered for nothing */
+    if (!events)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, &ev);
+    else if (epoll_ctl(epoll_fd, c->poll_events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                       c->fd, &ev) < 0)
+        http_log("epoll_ctl failed for fd %d: %s\n", c->fd, strerror(errno));
+    c->poll_events = events;
+}
+#else
+static void update_poll_events(HTTPContext *c)
+{
+}
+#endif
+
+/* handle a connection and close it if needed */
+static void process_connection(HTTPContext *c)
+{
+    if (handle_connection(c) < 0) {
+        /* close and free the connection */
+        log_connection(c);
+        close_connection(c);
+    } else {
+        update_poll_events(c);
+    }
+}
+
+#if HAVE_EPOLL_CREATE1
+/* Event loop using persistent epoll registrations, so that waiting does
+ * not cost a walk over all the connections. Connections without socket
+ * events (packetized output, request timeouts) are still served by a walk
+ * over the connection list, done once per tick instead of once per
+ * wakeup. All connections are still handled by this one thread: the
+ * handlers share feeds, bandwidth accounting and the connection list
+ * without locking. tools/httpload measures the per request cost. */
+static int epoll_server(int server_fd, int rtsp_server_fd)
+{
+    struct epoll_event ev = { 0 }, *events;
+    int nb_events = nb_max_http_connections + 2;
+    int64_t next_walk = 0;
+    HTTPContext *c, *c_next;
+    int i, n, delay;
+
+    if (!(events = av_malloc(nb_events * sizeof(*events)))) {
+        http_log("Impossible to allocate an epoll event table handling %d connections.\n", nb_max_http_connections);
+        return -1;
+    }
+
+    ev.events = EPOLLIN;
+    if (server_fd) {
+        ev.data.ptr = &server_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &ev);
+    }
+    if (rtsp_server_fd) {
+        ev.data.ptr = &rtsp_server_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, rtsp_server_fd, &ev);
+    }
+
+    for(;;) {
+        delay = FFMAX(next_walk - av_gettime() / 1000, 0);
+        n = epoll_wait(epoll_fd, events, nb_events, delay);
+        if (n < 0 && ff_neterrno() != AVERROR(EINTR)) {
+            av_free(events);
+            return -1;
+        }
+
+        cur_time = av_gettime() / 1000;
+
+        if (need_to_start_children) {
+            need_to_start_children = 0;
+            start_children(first_feed);
+        }
+
+        for (i = 0; i < n; i++) {
+            if (events[i].data.ptr == &server_fd) {
+                new_connection(server_fd, 0);
+            } else if (events[i].data.ptr == &rtsp_server_fd) {
+                new_connection(rtsp_server_fd, 1);
+            } else {
+                int e = events[i].events;
+                c = events[i].data.ptr;
+                c->revents = (e & EPOLLIN  ? POLLIN  : 0) |
+                             (e & EPOLLOUT ? POLLOUT : 0) |
+                             (e & EPOLLERR ? POLLERR : 0) |
+                             (e & EPOLLHUP ? POLLHUP : 0);
+                process_connection(c);
+            }
+        }
+
+        if (cur_time >= next_walk) {
+            delay = 1000;
+            for(c = first_http_ctx; c != NULL; c = c_next) {
+                c_next = c->next;
+                c->revents = 0;
+                process_connection(c);
+            }
+            for(c = first_http_ctx; c != NULL; c = c->next)
+                connection_events(c, &delay);
+            next_walk = cur_time + delay;
+        }
+    }
+}
+#endif
+
 /* main loop of the http server */
 static int http_server(void)
 {
     int server_fd = 0, rtsp_server_fd = 0;
-    int ret, delay, delay1;
+    int ret, delay;
     struct pollfd *poll_table, *poll_entry;
     HTTPContext *c, *c_next;
 
-    if(!(poll_table = av_mallocz((nb_max_http_connections + 2)*sizeof(*poll_table)))) {
-        http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
-        return -1;
-    }
-
     if (my_http_addr.sin_port) {
         server_fd = socket_open_listen(&my_http_addr);
         if (server_fd < 0)
@@ -654,6 +824,17 @@ static int http_server(void)
 
     start_multicast();
 
+#if HAVE_EPOLL_CREATE1
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd >= 0)
+        return epoll_server(server_fd, rtsp_server_fd);
+#endif
+
+    if(!(poll_table = av_mallocz((nb_max_http_connections + 2)*sizeof(*poll_table)))) {
+        http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
+        return -1;
+    }
+
     for(;;) {
         poll_entry = poll_table;
         if (server_fd) {
@@ -671,48 +852,14 @@ static int http_server(void)
         c = first_http_ctx;
         delay = 1000;
         while (c != NULL) {
-            int fd;
-            fd = c->fd;
-            switch(c->state) {
-            case HTTPSTATE_SEND_HEADER:
-            case RTSPSTATE_SEND_REPLY:
-            case RTSPSTATE_SEND_PACKET:
+            int events = connection_events(c, &delay);
+            if (events) {
                 c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLOUT;
+                poll_entry->fd = c->fd;
+                poll_entry->events = events;
                 poll_entry++;
-                break;
-            case HTTPSTATE_SEND_DATA_HEADER:
-            case HTTPSTATE_SEND_DATA:
-            case HTTPSTATE_SEND_DATA_TRAILER:
-                if (!c->is_packetized) {
-                    /* for TCP, we output as much as we can (may need to put a limit) */
-                    c->poll_entry = poll_entry;
-                    poll_entry->fd = fd;
-                    poll_entry->events = POLLOUT;
-                    poll_entry++;
-                } else {
-                    /* when avserver is doing the timing, we work by
-                       looking at which packet need to be sent every
-                       10 ms */
-                    delay1 = 10; /* one tick wait XXX: 10 ms assumed */
-                    if (delay1 < delay)
-                        delay = delay1;
-                }
-                break;
-            case HTTPSTATE_WAIT_REQUEST:
-            case HTTPSTATE_RECEIVE_DATA:
-            case HTTPSTATE_WAIT_FEED:
-            case RTSPSTATE_WAIT_REQUEST:
-                /* need to catch errors */
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLIN;/* Maybe this will work */
-                poll_entry++;
-                break;
-            default:
+            } else {
                 c->poll_entry = NULL;
-                break;
             }
             c = c->next;
         }
@@ -736,11 +883,8 @@ static int http_server(void)
         /* now handle the events */
         for(c = first_http_ctx; c != NULL; c = c_next) {
             c_next = c->next;
-            if (handle_connection(c) < 0) {
-                /* close and free the connection */
-                log_connection(c);
-                close_connection(c);
-            }
+            c->revents = c->poll_entry ? c->poll_entry->revents : 0;
+            process_connection(c);
         }
 
         poll_entry = poll_table;
@@ -828,6 +972,7 @@ static void new_connection(int server_fd, int is_rtsp)
     nb_connections++;
 
     start_wait_request(c, is_rtsp);
+    update_poll_events(c);
 
     return;
 
@@ -864,6 +1009,10 @@ static void close_connection(HTTPContext *c)
     }
 
     /* remove connection associated resources */
+#if HAVE_EPOLL_CREATE1
+    if (c->poll_events)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+#endif
     if (c->fd >= 0)
         closesocket(c->fd);
     if (c->fmt_in) {
@@ -894,21 +1043,25 @@ static void close_connection(HTTPContext *c)
             ffurl_close(h);
     }
 
-    ctx = &c->fmt_ctx;
-
-    if (!c->last_packet_sent && c->state == HTTPSTATE_SEND_DATA_TRAILER) {
-        if (ctx->oformat) {
-            /* prepare header */
-            if (avio_open_dyn_buf(&ctx->pb) >= 0) {
-                av_write_trailer(ctx);
-                av_freep(&c->pb_buffer);
-                avio_close_dyn_buf(ctx->pb, &c->pb_buffer);
+    ctx = c->fmt_ctx;
+    if (ctx) {
+        if (!c->last_packet_sent && c->state == HTTPSTATE_SEND_DATA_TRAILER) {
+            if (ctx->oformat) {
+                /* prepare header */
+                if (avio_open_dyn_buf(&ctx->pb) >= 0) {
+                    av_write_trailer(ctx);
+                    av_freep(&c->pb_buffer);
+                    avio_close_dyn_buf(ctx->pb, &c->pb_buffer);
+                }
             }
         }
-    }
 
-    for(i=0; i<ctx->nb_streams; i++)
-        av_free(ctx->streams[i]);
+        /* the streams are shallow copies of the FFStream ones */
+        for(i=0; i<ctx->nb_streams; i++)
+            av_free(ctx->streams[i]);
+        ctx->nb_streams = 0;
+        avformat_free_context(ctx);
+    }
 
     if (c->stream && !c->post && c->stream->stream_type == STREAM_TYPE_LIVE)
         current_bandwidth -= c->stream->bandwidth;
@@ -936,11 +1089,11 @@ static int handle_connection(HTTPContext *c)
         /* timeout ? */
         if ((c->timeout - cur_time) < 0)
             return -1;
-        if (c->poll_entry->revents & (POLLERR | POLLHUP))
+        if (c->revents & (POLLERR | POLLHUP))
             return -1;
 
         /* no need to read if no events */
-        if (!(c->poll_entry->revents & POLLIN))
+        if (!(c->revents & POLLIN))
             return 0;
         /* read the data */
     read_loop:
@@ -974,11 +1127,11 @@ static int handle_connection(HTTPContext *c)
         break;
 
     case HTTPSTATE_SEND_HEADER:
-        if (c->poll_entry->revents & (POLLERR | POLLHUP))
+        if (c->revents & (POLLERR | POLLHUP))
             return -1;
 
         /* no need to write if no events */
-        if (!(c->poll_entry->revents & POLLOUT))
+        if (!(c->revents & POLLOUT))
             return 0;
         len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
         if (len < 0) {
@@ -1012,11 +1165,11 @@ static int handle_connection(HTTPContext *c)
            input streams sets the speed). It may be better to verify
            that we do not rely too much on the kernel queues */
         if (!c->is_packetized) {
-            if (c->poll_entry->revents & (POLLERR | POLLHUP))
+            if (c->revents & (POLLERR | POLLHUP))
                 return -1;
 
             /* no need to read if no events */
-            if (!(c->poll_entry->revents & POLLOUT))
+            if (!(c->revents & POLLOUT))
                 return 0;
         }
         if (http_send_data(c) < 0)
@@ -1027,28 +1180,28 @@ static int handle_connection(HTTPContext *c)
         break;
     case HTTPSTATE_RECEIVE_DATA:
         /* no need to read if no events */
-        if (c->poll_entry->revents & (POLLERR | POLLHUP))
+        if (c->revents & (POLLERR | POLLHUP))
             return -1;
-        if (!(c->poll_entry->revents & POLLIN))
+        if (!(c->revents & POLLIN))
             return 0;
         if (http_receive_data(c) < 0)
             return -1;
         break;
     case HTTPSTATE_WAIT_FEED:
         /* no need to read if no events */
-        if (c->poll_entry->revents & (POLLIN | POLLERR | POLLHUP))
+        if (c->revents & (POLLIN | POLLERR | POLLHUP))
             return -1;
 
         /* nothing to do, we'll be waken up by incoming feed packets */
         break;
 
     case RTSPSTATE_SEND_REPLY:
-        if (c->poll_entry->revents & (POLLERR | POLLHUP)) {
+        if (c->revents & (POLLERR | POLLHUP)) {
             av_freep(&c->pb_buffer);
             return -1;
         }
         /* no need to write if no events */
-        if (!(c->poll_entry->revents & POLLOUT))
+        if (!(c->revents & POLLOUT))
             return 0;
         len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
         if (len < 0) {
@@ -1069,12 +1222,12 @@ static int handle_connection(HTTPContext *c)
         }
         break;
     case RTSPSTATE_SEND_PACKET:
-        if (c->poll_entry->revents & (POLLERR | POLLHUP)) {
+        if (c->revents & (POLLERR | POLLHUP)) {
             av_freep(&c->packet_buffer);
             return -1;
         }
         /* no need to write if no events */
-        if (!(c->poll_entry->revents & POLLOUT))
+        if (!(c->revents & POLLOUT))
             return 0;
         len = send(c->fd, c->packet_buffer_ptr,
                     c->packet_buffer_end - c->packet_buffer_ptr, 0);
@@ -2138,13 +2291,154 @@ static void compute_status(HTTPContext *c)
     c->buffer_end = c->pb_buffer + len;
 }
 
+/* open the reader which fills the packet ring of a feed, starting from
+   the current end of the feed file */
+static int feed_ring_open(FFStream *feed)
+{
+    AVFormatContext *s = NULL;
+
+    if (!feed->ring) {
+        feed->ring      = av_mallocz(FEED_RING_SIZE * sizeof(*feed->ring));
+        feed->ring_time = av_mallocz(FEED_RING_SIZE * sizeof(*feed->ring_time));
+        if (!feed->ring || !feed->ring_time) {
+            av_freep(&feed->ring);
+            av_freep(&feed->ring_time);
+            feed->ring_failed = 1;
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    if (avformat_open_input(&s, feed->feed_filename,
+                            av_find_input_format("ffm"), NULL) < 0) {
+        http_log("could not open feed ring for %s\n", feed->feed_filename);
+        feed->ring_failed = 1;
+        return -1;
+    }
+    s->flags |= AVFMT_FLAG_GENPTS;
+    if (s->iformat->read_seek)
+        av_seek_frame(s, -1, av_gettime(), 0);
+
+    feed->ring_in        = s;
+    feed->ring_open_time = cur_time;
+    return 0;
+}
+
+/* append the packets newly written to the feed file to its ring, dropping
+   the oldest ones when it is full */
+static void feed_ring_update(FFStream *feed)
+{
+    AVPacket pkt;
+
+    /* after a failure, viewers read the feed file until the next feeder */
+    if (!feed->ring_in && (feed->ring_failed || feed_ring_open(feed) < 0))
+        return;
+
+    ffm_set_write_index(feed->ring_in, feed->feed_write_index, feed->feed_size);
+    while (av_read_frame(feed->ring_in, &pkt) >= 0) {
+        int idx = feed->ring_end % FEED_RING_SIZE;
+
+        if (av_dup_packet(&pkt) < 0) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        if (feed->ring_end - feed->ring_start == FEED_RING_SIZE)
+            av_free_packet(&feed->ring[feed->ring_start++ % FEED_RING_SIZE]);
+        feed->ring[idx]      = pkt;
+        feed->ring_time[idx] = cur_time;
+        feed->ring_end++;
+    }
+}
+
+/* return the position of the first packet of the ring received at or after
+   time (in ms), or -1 if the ring does not cover that time */
+static int64_t feed_ring_seek(FFStream *feed, int64_t time)
+{
+    int64_t lo = feed->ring_start, hi = feed->ring_end;
+
+    if (!feed->ring_in)
+        return -1;
+    if (feed->ring_start ? time < feed->ring_time[lo % FEED_RING_SIZE]
+                         : time < feed->ring_open_time)
+        return -1;
+
+    while (lo < hi) {
+        int64_t mid = (lo + hi) >> 1;
+        if (feed->ring_time[mid % FEED_RING_SIZE] < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* empty the ring of a feed before a new feeder writes to it. The viewers
+   served from the ring are ended, since the new feeder may send different
+   streams; the ring is reopened at the next packet written. */
+static void feed_ring_reset(FFStream *feed)
+{
+    HTTPContext *c;
+
+    for (c = first_http_ctx; c; c = c->next) {
+        if (!c->stream || c->stream->feed != feed || c->ring_pos < 0)
+            continue;
+        c->ring_pos = FEED_RING_ENDED;
+        if (c->state == HTTPSTATE_WAIT_FEED) {
+            c->state = HTTPSTATE_SEND_DATA;
+            update_poll_events(c);
+        }
+    }
+
+    if (feed->ring_in)
+        avformat_close_input(&feed->ring_in);
+    if (feed->ring)
+        for (; feed->ring_start < feed->ring_end; feed->ring_start++)
+            av_free_packet(&feed->ring[feed->ring_start % FEED_RING_SIZE]);
+    feed->ring_start  = feed->ring_end = 0;
+    feed->ring_failed = 0;
+}
+
+/* demuxer context describing the packets read by a connection */
+static AVFormatContext *input_context(HTTPContext *c)
+{
+    return c->ring_pos >= 0 ? c->stream->feed->ring_in : c->fmt_in;
+}
+
+static int read_input_packet(HTTPContext *c, AVPacket *pkt)
+{
+    FFStream *feed = c->stream->feed;
+
+    if (c->ring_pos == FEED_RING_ENDED)
+        return AVERROR_EOF;
+    if (c->ring_pos < 0) {
+        if (feed)
+            ffm_set_write_index(c->fmt_in, feed->feed_write_index,
+                                feed->feed_size);
+        return av_read_frame(c->fmt_in, pkt);
+    }
+
+    if (c->ring_pos < feed->ring_start) {
+        http_log("%s: viewer too slow, skipping %"PRId64" packets\n",
+                 inet_ntoa(c->from_addr.sin_addr), feed->ring_start - c->ring_pos);
+        c->ring_pos = feed->ring_start;
+        /* the skipped packets are lost, so wait for the next key frame */
+        if (c->stream->send_on_key)
+            c->got_key_frame = 0;
+    }
+    if (c->ring_pos == feed->ring_end)
+        return AVERROR(EAGAIN);
+    av_init_packet(pkt);
+    return av_packet_ref(pkt, &feed->ring[c->ring_pos++ % FEED_RING_SIZE]);
+}
+
 static int open_input_stream(HTTPContext *c, const char *info)
 {
     char buf[128];
     char input_filename[1024];
     AVFormatContext *s = NULL;
     int i, ret;
-    int64_t stream_pos;
+    int64_t stream_pos, ring_pos = -1;
+
+    c->ring_pos = -1;
 
     /* find file name */
     if (c->stream->feed) {
@@ -2158,6 +2452,10 @@ static int open_input_stream(HTTPContext *c, const char *info)
             stream_pos = av_gettime() - prebuffer * (int64_t)1000000;
         } else
             stream_pos = av_gettime() - c->stream->prebuffer * (int64_t)1000;
+        /* recent data is served from memory, the feed file is only read
+           by viewers asking for older data */
+        ring_pos = feed_ring_seek(c->stream->feed,
+                                  cur_time - (av_gettime() - stream_pos) / 1000);
     } else {
         strcpy(input_filename, c->stream->feed_filename);
         /* compute position (relative time) */
@@ -2170,6 +2468,11 @@ static int open_input_stream(HTTPContext *c, const char *info)
     if (input_filename[0] == '\0')
         return -1;
 
+    if (ring_pos >= 0) {
+        c->ring_pos = ring_pos;
+        goto opened;
+    }
+
     /* open stream */
     if ((ret = avformat_open_input(&s, input_filename, c->stream->ifmt, &c->stream->in_opts)) < 0) {
         http_log("could not open %s: %d\n", input_filename, ret);
@@ -2183,6 +2486,10 @@ static int open_input_stream(HTTPContext *c, const char *info)
         return -1;
     }
 
+    if (c->fmt_in->iformat->read_seek)
+        av_seek_frame(c->fmt_in, -1, stream_pos, 0);
+
+ opened:
     /* choose stream as clock source (we favorize video stream if
        present) for packet sending */
     c->pts_stream_index = 0;
@@ -2193,8 +2500,6 @@ static int open_input_stream(HTTPContext *c, const char *info)
         }
     }
 
-    if (c->fmt_in->iformat->read_seek)
-        av_seek_frame(c->fmt_in, -1, stream_pos, 0);
     /* set the start time (needed for maxtime and RTP packet timing) */
     c->start_time = cur_time;
     c->first_pts = AV_NOPTS_VALUE;
@@ -2233,17 +2538,19 @@ static int http_prepare_data(HTTPContext *c)
     av_freep(&c->pb_buffer);
     switch(c->state) {
     case HTTPSTATE_SEND_DATA_HEADER:
-        memset(&c->fmt_ctx, 0, sizeof(c->fmt_ctx));
-        av_dict_set(&c->fmt_ctx.metadata, "author"   , c->stream->author   , 0);
-        av_dict_set(&c->fmt_ctx.metadata, "comment"  , c->stream->comment  , 0);
-        av_dict_set(&c->fmt_ctx.metadata, "copyright", c->stream->copyright, 0);
-        av_dict_set(&c->fmt_ctx.metadata, "title"    , c->stream->title    , 0);
+        c->fmt_ctx = avformat_alloc_context();
+        if (!c->fmt_ctx)
+            return -1;
+        av_dict_set(&c->fmt_ctx->metadata, "author"   , c->stream->author   , 0);
+        av_dict_set(&c->fmt_ctx->metadata, "comment"  , c->stream->comment  , 0);
+        av_dict_set(&c->fmt_ctx->metadata, "copyright", c->stream->copyright, 0);
+        av_dict_set(&c->fmt_ctx->metadata, "title"    , c->stream->title    , 0);
 
-        c->fmt_ctx.streams = av_mallocz(sizeof(AVStream *) * c->stream->nb_streams);
+        c->fmt_ctx->streams = av_mallocz(sizeof(AVStream *) * c->stream->nb_streams);
 
         for(i=0;i<c->stream->nb_streams;i++) {
             AVStream *src;
-            c->fmt_ctx.streams[i] = av_mallocz(sizeof(AVStream));
+            c->fmt_ctx->streams[i] = av_mallocz(sizeof(AVStream));
             /* if file or feed, then just take streams from FFStream struct */
             if (!c->stream->feed ||
                 c->stream->feed == c->stream)
@@ -2251,38 +2558,38 @@ static int http_prepare_data(HTTPContext *c)
             else
                 src = c->stream->feed->streams[c->stream->feed_streams[i]];
 
-            *(c->fmt_ctx.streams[i]) = *src;
-            c->fmt_ctx.streams[i]->priv_data = 0;
-            c->fmt_ctx.streams[i]->codec->frame_number = 0; /* XXX: should be done in
+            *(c->fmt_ctx->streams[i]) = *src;
+            c->fmt_ctx->streams[i]->priv_data = 0;
+            c->fmt_ctx->streams[i]->codec->frame_number = 0; /* XXX: should be done in
                                            AVStream, not in codec */
         }
         /* set output format parameters */
-        c->fmt_ctx.oformat = c->stream->fmt;
-        c->fmt_ctx.nb_streams = c->stream->nb_streams;
+        c->fmt_ctx->oformat = c->stream->fmt;
+        c->fmt_ctx->nb_streams = c->stream->nb_streams;
 
         c->got_key_frame = 0;
 
         /* prepare header and save header data in a stream */
-        if (avio_open_dyn_buf(&c->fmt_ctx.pb) < 0) {
+        if (avio_open_dyn_buf(&c->fmt_ctx->pb) < 0) {
             /* XXX: potential leak */
             return -1;
         }
-        c->fmt_ctx.pb->seekable = 0;
+        c->fmt_ctx->pb->seekable = 0;
 
         /*
          * HACK to avoid mpeg ps muxer to spit many underflow errors
          * Default value from Libav
          * Try to set it use configuration option
          */
-        c->fmt_ctx.max_delay = (int)(0.7*AV_TIME_BASE);
+        c->fmt_ctx->max_delay = (int)(0.7*AV_TIME_BASE);
 
-        if (avformat_write_header(&c->fmt_ctx, NULL) < 0) {
+        if (avformat_write_header(c->fmt_ctx, NULL) < 0) {
             http_log("Error writing output header\n");
             return -1;
         }
-        av_dict_free(&c->fmt_ctx.metadata);
+        av_dict_free(&c->fmt_ctx->metadata);
 
-        len = avio_close_dyn_buf(c->fmt_ctx.pb, &c->pb_buffer);
+        len = avio_close_dyn_buf(c->fmt_ctx->pb, &c->pb_buffer);
         c->buffer_ptr = c->pb_buffer;
         c->buffer_end = c->pb_buffer + len;
 
@@ -2292,11 +2599,6 @@ static int http_prepare_data(HTTPContext *c)
     case HTTPSTATE_SEND_DATA:
         /* find a new packet */
         /* read a packet from the input stream */
-        if (c->stream->feed)
-            ffm_set_write_index(c->fmt_in,
-                                c->stream->feed->feed_write_index,
-                                c->stream->feed->feed_size);
-
         if (c->stream->max_time &&
             c->stream->max_time + c->start_time - cur_time < 0)
             /* We have timed out */
@@ -2304,9 +2606,9 @@ static int http_prepare_data(HTTPContext *c)
         else {
             AVPacket pkt;
         redo:
-            ret = av_read_frame(c->fmt_in, &pkt);
+            ret = read_input_packet(c, &pkt);
             if (ret < 0) {
-                if (c->stream->feed) {
+                if (c->stream->feed && c->ring_pos != FEED_RING_ENDED) {
                     /* if coming from feed, it means we reached the end of the
                        ffm file, so must wait for more data */
                     c->state = HTTPSTATE_WAIT_FEED;
@@ -2330,7 +2632,7 @@ static int http_prepare_data(HTTPContext *c)
                 int source_index = pkt.stream_index;
                 /* update first pts if needed */
                 if (c->first_pts == AV_NOPTS_VALUE) {
-                    c->first_pts = av_rescale_q(pkt.dts, c->fmt_in->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q);
+                    c->first_pts = av_rescale_q(pkt.dts, input_context(c)->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q);
                     c->start_time = cur_time;
                 }
                 /* send it to the appropriate stream */
@@ -2348,7 +2650,7 @@ static int http_prepare_data(HTTPContext *c)
                     }
                     for(i=0;i<c->stream->nb_streams;i++) {
                         if (c->stream->feed_streams[i] == pkt.stream_index) {
-                            AVStream *st = c->fmt_in->streams[source_index];
+                            AVStream *st = input_context(c)->streams[source_index];
                             pkt.stream_index = i;
                             if (pkt.flags & AV_PKT_FLAG_KEY &&
                                 (st->codec->codec_type == AVMEDIA_TYPE_VIDEO ||
@@ -2362,7 +2664,7 @@ static int http_prepare_data(HTTPContext *c)
                     AVCodecContext *codec;
                     AVStream *ist, *ost;
                 send_it:
-                    ist = c->fmt_in->streams[source_index];
+                    ist = input_context(c)->streams[source_index];
                     /* specific handling for RTP: we use several
                        output stream (one for each RTP
                        connection). XXX: need more abstract handling */
@@ -2382,7 +2684,7 @@ static int http_prepare_data(HTTPContext *c)
                         /* only one stream per RTP connection */
                         pkt.stream_index = 0;
                     } else {
-                        ctx = &c->fmt_ctx;
+                        ctx = c->fmt_ctx;
                         /* Fudge here */
                         codec = ctx->streams[pkt.stream_index]->codec;
                     }
@@ -2434,13 +2736,13 @@ static int http_prepare_data(HTTPContext *c)
         /* last packet test ? */
         if (c->last_packet_sent || c->is_packetized)
             return -1;
-        ctx = &c->fmt_ctx;
+        ctx = c->fmt_ctx;
         /* prepare header */
         if (avio_open_dyn_buf(&ctx->pb) < 0) {
             /* XXX: potential leak */
             return -1;
         }
-        c->fmt_ctx.pb->seekable = 0;
+        c->fmt_ctx->pb->seekable = 0;
         av_write_trailer(ctx);
         len = avio_close_dyn_buf(ctx->pb, &c->pb_buffer);
         c->buffer_ptr = c->pb_buffer;
@@ -2538,6 +2840,7 @@ static int http_send_data(HTTPContext *c)
                            send it later, so a new state is needed to
                            "lock" the RTSP TCP connection */
                         rtsp_c->state = RTSPSTATE_SEND_PACKET;
+                        update_poll_events(rtsp_c);
                         break;
                     } else
                         /* all data has been sent */
@@ -2593,6 +2896,8 @@ static int http_start_receive_data(HTTPContext *c)
     }
     c->feed_fd = fd;
 
+    feed_ring_reset(c->stream);
+
     if (c->stream->truncate) {
         /* truncate feed file */
         ffm_write_write_index(c->feed_fd, FFM_PACKET_SIZE);
@@ -2708,11 +3013,15 @@ static int http_receive_data(HTTPContext *c)
                 goto fail;
             }
 
+            feed_ring_update(feed);
+
             /* wake up any waiting connections */
             for(c1 = first_http_ctx; c1 != NULL; c1 = c1->next) {
                 if (c1->state == HTTPSTATE_WAIT_FEED &&
-                    c1->stream->feed == c->stream->feed)
+                    c1->stream->feed == c->stream->feed) {
                     c1->state = HTTPSTATE_SEND_DATA;
+                    update_poll_events(c1);
+                }
             }
         } else {
             /* We have a header in our hands that contains useful data */
@@ -2767,8 +3076,10 @@ static int http_receive_data(HTTPContext *c)
     /* wake up any waiting connections to stop waiting for feed */
     for(c1 = first_http_ctx; c1 != NULL; c1 = c1->next) {
         if (c1->state == HTTPSTATE_WAIT_FEED &&
-            c1->stream->feed == c->stream->feed)
+            c1->stream->feed == c->stream->feed) {
             c1->state = HTTPSTATE_SEND_DATA_TRAILER;
+            update_poll_events(c1);
+        }
     }
     return -1;
 }
@@ -3749,8 +4060,12 @@ static void build_feed_streams(void)
             }
         }
         if (avio_check(feed->feed_filename, AVIO_FLAG_WRITE) <= 0) {
-            AVFormatContext s1 = {0}, *s = &s1;
+            AVFormatContext *s = avformat_alloc_context();
 
+            if (!s) {
+                http_log("Could not allocate the feed file header context\n");
+                exit(1);
+            }
             if (feed->readonly) {
                 http_log("Unable to create feed file '%s' as it is marked readonly\n",
                     feed->feed_filename);
@@ -3770,9 +4085,11 @@ static void build_feed_streams(void)
                 http_log("Container doesn't supports the required parameters\n");
                 exit(1);
             }
-            /* XXX: need better api */
-            av_freep(&s->priv_data);
             avio_close(s->pb);
+            /* the streams belong to the feed */
+            s->streams    = NULL;
+            s->nb_streams = 0;
+            avformat_free_context(s);
         }
         /* get feed size and write index */
         fd = open(feed->feed_filename, O_RDONLY);
@@ -60,6 +60,10 @@ typedef struct pthread_cond_t {
     void *ptr;
 } pthread_cond_t;
 
+/* 0: not run, 1: running, 2: done */
+typedef LONG pthread_once_t;
+#define PTHREAD_ONCE_INIT 0
+
 /* function pointers to conditional variable API on windows 6.0+ kernels */
 #if _WIN32_WINNT < 0x0600
 static void (WINAPI *cond_broadcast)(pthread_cond_t *cond);
@@ -133,6 +137,19 @@ typedef struct  win32_cond_t {
     volatile int is_broadcast;
 } win32_cond_t;
 
+static av_unused int pthread_once(pthread_once_t *once_control,
+                                  void (*init_routine)(void))
+{
+    if (!InterlockedCompareExchange(once_control, 1, 0)) {
+        init_routine();
+        InterlockedExchange(once_control, 2);
+    } else {
+        while (InterlockedCompareExchange(once_control, 2, 2) != 2)
+            Sleep(0);
+    }
+    return 0;
+}
+
 static void pthread_cond_init(pthread_cond_t *cond, const void *unused_attr)
 {
     win32_cond_t *win32_cond = NULL;
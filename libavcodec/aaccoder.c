@@ -70,7 +70,7 @@ static av_always_inline int quant(float coef, const float Q)
 }
 
 static void quantize_bands(int *out, const float *in, const float *scaled,
-                           int size, float Q34, int is_signed, int maxval)
+                           int size, int is_signed, int maxval, const float Q34)
 {
     int i;
     double qc;
@@ -131,10 +131,10 @@ static av_always_inline float quantize_and_encode_band_cost_template(
         return cost * lambda;
     }
     if (!scaled) {
-        abs_pow34_v(s->scoefs, in, size);
+        s->abs_pow34(s->scoefs, in, size);
         scaled = s->scoefs;
     }
-    quantize_bands(s->qcoefs, in, scaled, size, Q34, !BT_UNSIGNED, maxval);
+    s->quant_bands(s->qcoefs, in, scaled, size, !BT_UNSIGNED, maxval, Q34);
     if (BT_UNSIGNED) {
         off = 0;
     } else {
@@ -323,7 +323,7 @@ static void encode_window_bands_info(AACEncContext *s, SingleChannelElement *sce
     float next_minrd = INFINITY;
     int next_mincb = 0;
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = 0.0f;
@@ -424,7 +424,7 @@ static void codebook_trellis_rate(AACEncContext *s, SingleChannelElement *sce,
     float next_minbits = INFINITY;
     int next_mincb = 0;
 
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     start = win*128;
     for (cb = 0; cb < 12; cb++) {
         path[0][cb].cost     = run_bits+4;
@@ -612,7 +612,7 @@ static void search_for_quantizers_anmr(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     idx = 1;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0; g < sce->ics.num_swb; g++) {
@@ -701,8 +701,20 @@ static void search_for_quantizers_anmr(AVCodecContext *avctx, AACEncContext *s,
                 sce->sf_idx[(w+w2)*16+g] = sce->sf_idx[w*16+g];
 }
 
+/**
+ * Maximum number of outer loop iterations of the two-loop search
+ * for each search_speed value.
+ */
+static const uint8_t twoloop_max_its[] = { 10, 5, 2 };
+
 /**
  * two-loop quantizers search taken from ISO 13818-7 Appendix C
+ *
+ * The cost of each band is cached for the scalefactors it was last evaluated
+ * with, as the inner loop keeps stepping back and forth between the same
+ * values. With a non-zero search_speed the number of iterations is reduced and
+ * a pass of the inner loop stops evaluating bands as soon as the bit budget is
+ * known to be exceeded, when another pass is certain to follow.
  */
 static void search_for_quantizers_twoloop(AVCodecContext *avctx,
                                           AACEncContext *s,
@@ -717,6 +729,8 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
     int its  = 0;
     int allz = 0;
     float minthr = INFINITY;
+    const int speed   = s->options.search_speed;
+    const int max_its = twoloop_max_its[speed];
 
     // for values above this the decoder might end up in an endless loop
     // due to always having more bits than what can be encoded.
@@ -755,7 +769,8 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
 
     if (!allz)
         return;
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
+    memset(s->band_cost, -1, sizeof(s->band_cost));
 
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
@@ -774,7 +789,7 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
         //inner loop - quantize spectrum to fit into given number of bits
         qstep = its ? 1 : 32;
         do {
-            int prev = -1;
+            int prev = -1, skip = 0;
             tbits = 0;
             fflag = 0;
             for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
@@ -782,35 +797,57 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
                 for (g = 0;  g < sce->ics.num_swb; g++) {
                     const float *coefs = sce->coeffs + start;
                     const float *scaled = s->scoefs + start;
+                    const int sf = sce->sf_idx[w*16+g];
+                    AACBandCost *cost = &s->band_cost[w*16+g][sf & 15];
                     int bits = 0;
                     int cb;
                     float dist = 0.0f;
 
-                    if (sce->zeroes[w*16+g] || sce->sf_idx[w*16+g] >= 218) {
+                    if (sce->zeroes[w*16+g] || sf >= 218) {
                         start += sce->ics.swb_sizes[g];
                         continue;
                     }
-                    minscaler = FFMIN(minscaler, sce->sf_idx[w*16+g]);
-                    cb = find_min_book(maxvals[w*16+g], sce->sf_idx[w*16+g]);
-                    for (w2 = 0; w2 < sce->ics.group_len[w]; w2++) {
-                        int b;
-                        dist += quantize_band_cost(s, coefs + w2*128,
-                                                   scaled + w2*128,
-                                                   sce->ics.swb_sizes[g],
-                                                   sce->sf_idx[w*16+g],
-                                                   cb,
-                                                   1.0f,
-                                                   INFINITY,
-                                                   &b);
-                        bits += b;
+                    minscaler = FFMIN(minscaler, sf);
+                    if (skip) {
+                        start += sce->ics.swb_sizes[g];
+                        continue;
+                    }
+                    if (cost->sf_idx == sf) {
+                        dist = cost->dist;
+                        bits = cost->bits;
+                    } else {
+                        cb = find_min_book(maxvals[w*16+g], sf);
+                        for (w2 = 0; w2 < sce->ics.group_len[w]; w2++) {
+                            int b;
+                            dist += quantize_band_cost(s, coefs + w2*128,
+                                                       scaled + w2*128,
+                                                       sce->ics.swb_sizes[g],
+                                                       sf,
+                                                       cb,
+                                                       1.0f,
+                                                       INFINITY,
+                                                       &b);
+                            bits += b;
+                        }
+                        cost->sf_idx = sf;
+                        cost->dist   = dist;
+                        cost->bits   = bits;
                     }
                     dists[w*16+g] = dist - bits;
                     if (prev != -1) {
-                        bits += ff_aac_scalefactor_bits[sce->sf_idx[w*16+g] - prev + SCALE_DIFF_ZERO];
+                        bits += ff_aac_scalefactor_bits[sf - prev + SCALE_DIFF_ZERO];
                     }
                     tbits += bits;
                     start += sce->ics.swb_sizes[g];
-                    prev = sce->sf_idx[w*16+g];
+                    prev = sf;
+                    /* Once the budget is exceeded, the scalefactors are
+                     * raised and, unless qstep is 1 and sf_idx[0] reaches
+                     * 217, all bands are evaluated again in another pass,
+                     * whose distortions are the ones used by the outer
+                     * loop. Only minscaler still needs the remaining bands. */
+                    if (speed && tbits > destbits*1.02 &&
+                        (qstep > 1 || sce->sf_idx[0] < 216))
+                        skip = 1;
                 }
             }
             if (tbits > destbits) {
@@ -846,7 +883,7 @@ static void search_for_quantizers_twoloop(AVCodecContext *avctx,
             }
         }
         its++;
-    } while (fflag && its < 10);
+    } while (fflag && its < max_its);
 }
 
 static void search_for_quantizers_faac(AVCodecContext *avctx, AACEncContext *s,
@@ -936,7 +973,7 @@ static void search_for_quantizers_faac(AVCodecContext *avctx, AACEncContext *s,
         }
     }
     memset(sce->sf_idx, 0, sizeof(sce->sf_idx));
-    abs_pow34_v(s->scoefs, sce->coeffs, 1024);
+    s->abs_pow34(s->scoefs, sce->coeffs, 1024);
     for (w = 0; w < sce->ics.num_windows; w += sce->ics.group_len[w]) {
         start = w*128;
         for (g = 0;  g < sce->ics.num_swb; g++) {
@@ -1076,10 +1113,10 @@ static void search_for_ms(AACEncContext *s, ChannelElement *cpe,
                         S[i] =  M[i]
                               - sce1->coeffs[start+w2*128+i];
                     }
-                    abs_pow34_v(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(M34, M,                         sce0->ics.swb_sizes[g]);
-                    abs_pow34_v(S34, S,                         sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(L34, sce0->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(R34, sce1->coeffs+start+w2*128, sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(M34, M,                         sce0->ics.swb_sizes[g]);
+                    s->abs_pow34(S34, S,                         sce0->ics.swb_sizes[g]);
                     dist1 += quantize_band_cost(s, sce0->coeffs + start + w2*128,
                                                 L34,
                                                 sce0->ics.swb_sizes[g],
@@ -1138,3 +1175,9 @@ AACCoefficientsEncoder ff_aac_coders[] = {
         search_for_ms,
     },
 };
+
+av_cold void ff_aac_dsp_init(AACEncContext *s)
+{
+    s->abs_pow34   = abs_pow34_v;
+    s->quant_bands = quantize_bands;
+}
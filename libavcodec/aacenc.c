@@ -32,6 +32,7 @@
 
 #include "libavutil/float_dsp.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 #include "avcodec.h"
 #include "put_bits.h"
 #include "internal.h"
@@ -502,6 +503,23 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/**
+ * Search the quantizers of one channel.
+ * Channels are independent, so the search runs in parallel across the slice
+ * threads, each thread using its own scratch buffers.
+ */
+static int search_for_quantizers_thread(AVCodecContext *avctx, void *arg,
+                                        int jobnr, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    SingleChannelElement **sce = arg;
+    AACEncContext *t = s->thread_context ? &s->thread_context[threadnr] : s;
+
+    t->cur_channel = jobnr;
+    s->coder->search_for_quantizers(avctx, t, sce[jobnr], s->lambda);
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
@@ -511,6 +529,8 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     int i, ch, w, g, chans, tag, start_ch, ret;
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    SingleChannelElement *sce[AAC_MAX_CHANNELS];
+    int64_t search_time;
 
     if (s->last_frame == 2)
         return 0;
@@ -568,6 +588,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                 ics->group_len[w] = wi[ch].grouping[w];
 
             apply_window_and_mdct(s, &cpe->ch[ch], overlap);
+            sce[cur_channel] = &cpe->ch[ch];
         }
         start_ch += chans;
     }
@@ -583,23 +604,37 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & CODEC_FLAG_BITEXACT))
             put_bitstream_info(s, LIBAVCODEC_IDENT);
+
+        start_ch = 0;
+        for (i = 0; i < s->chan_map[0]; i++) {
+            const float *coeffs[2];
+            chans    = s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            for (ch = 0; ch < chans; ch++)
+                coeffs[ch] = cpe->ch[ch].coeffs;
+            s->psy.model->analyze(&s->psy, start_ch, coeffs, windows + start_ch);
+            start_ch += chans;
+        }
+        if (s->thread_context)
+            for (i = 0; i < avctx->thread_count; i++)
+                memcpy(&s->thread_context[i], s, offsetof(AACEncContext, qcoefs));
+        search_time = av_gettime();
+        avctx->execute2(avctx, search_for_quantizers_thread, sce, NULL,
+                        s->channels);
+        search_time = av_gettime() - search_time;
+        s->search_time += search_time;
+        av_log(avctx, AV_LOG_DEBUG, "frame %d: quantizer search took %"PRId64" us\n",
+               avctx->frame_number, search_time);
+
         start_ch = 0;
         memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
             FFPsyWindowInfo* wi = windows + start_ch;
-            const float *coeffs[2];
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (ch = 0; ch < chans; ch++)
-                coeffs[ch] = cpe->ch[ch].coeffs;
-            s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch + ch;
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
             cpe->common_window = 0;
             if (chans > 1
                 && wi[0].window_type[0] == wi[1].window_type[0]
@@ -660,6 +695,7 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         s->lambda = FFMIN(s->lambda, 65536.f);
     }
 
+    s->search_frames++;
     if (!frame)
         s->last_frame++;
 
@@ -675,6 +711,10 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
 {
     AACEncContext *s = avctx->priv_data;
 
+    if (s->search_frames)
+        av_log(avctx, AV_LOG_VERBOSE, "quantizer search: %"PRId64" us per frame\n",
+               s->search_time / s->search_frames);
+
     ff_mdct_end(&s->mdct1024);
     ff_mdct_end(&s->mdct128);
     ff_psy_end(&s->psy);
@@ -682,6 +722,7 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
     av_freep(&s->cpe);
+    av_freep(&s->thread_context);
     ff_af_queue_close(&s->afq);
     return 0;
 }
@@ -691,6 +732,7 @@ static av_cold int dsp_init(AVCodecContext *avctx, AACEncContext *s)
     int ret = 0;
 
     avpriv_float_dsp_init(&s->fdsp, avctx->flags & CODEC_FLAG_BITEXACT);
+    ff_aac_dsp_init(s);
 
     // window init
     ff_kbd_window_init(ff_aac_kbd_long_1024, 4.0, 1024);
@@ -712,6 +754,8 @@ static av_cold int alloc_buffers(AVCodecContext *avctx, AACEncContext *s)
     FF_ALLOCZ_OR_GOTO(avctx, s->buffer.samples, 3 * 1024 * s->channels * sizeof(s->buffer.samples[0]), alloc_fail);
     FF_ALLOCZ_OR_GOTO(avctx, s->cpe, sizeof(ChannelElement) * s->chan_map[0], alloc_fail);
     FF_ALLOCZ_OR_GOTO(avctx, avctx->extradata, 5 + FF_INPUT_BUFFER_PADDING_SIZE, alloc_fail);
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1)
+        FF_ALLOCZ_OR_GOTO(avctx, s->thread_context, sizeof(AACEncContext) * avctx->thread_count, alloc_fail);
 
     for(ch = 0; ch < s->channels; ch++)
         s->planar_samples[ch] = s->buffer.samples + 3 * 1024 * ch;
@@ -768,7 +812,7 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     if (ret = ff_psy_init(&s->psy, avctx, 2, sizes, lengths, s->chan_map[0], grouping))
         goto fail;
     s->psypp = ff_psy_preprocess_init(avctx);
-    s->coder = &ff_aac_coders[2];
+    s->coder = &ff_aac_coders[s->options.aac_coder];
 
     s->lambda = avctx->global_quality ? avctx->global_quality : 120;
 
@@ -792,6 +836,12 @@ static const AVOption aacenc_options[] = {
         {"auto",     "Selected by the Encoder", 0, AV_OPT_TYPE_CONST, {.i64 = -1 }, INT_MIN, INT_MAX, AACENC_FLAGS, "stereo_mode"},
         {"ms_off",   "Disable Mid/Side coding", 0, AV_OPT_TYPE_CONST, {.i64 =  0 }, INT_MIN, INT_MAX, AACENC_FLAGS, "stereo_mode"},
         {"ms_force", "Force Mid/Side for the whole frame if possible", 0, AV_OPT_TYPE_CONST, {.i64 =  1 }, INT_MIN, INT_MAX, AACENC_FLAGS, "stereo_mode"},
+    {"aac_coder", "Quantizer search algorithm", offsetof(AACEncContext, options.aac_coder), AV_OPT_TYPE_INT, {.i64 = 2}, 0, 3, AACENC_FLAGS, "aac_coder"},
+        {"faac",    "FAAC-inspired method",                     0, AV_OPT_TYPE_CONST, {.i64 = 0 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+        {"anmr",    "Average noise to mask ratio trellis search", 0, AV_OPT_TYPE_CONST, {.i64 = 1 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+        {"twoloop", "Two-loop search",                          0, AV_OPT_TYPE_CONST, {.i64 = 2 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+        {"fast",    "Constant quantizer",                       0, AV_OPT_TYPE_CONST, {.i64 = 3 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+    {"search_speed", "Speed of the two-loop quantizer search, higher is faster with lower quality", offsetof(AACEncContext, options.search_speed), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 2, AACENC_FLAGS},
     {NULL}
 };
 
@@ -812,7 +862,7 @@ AVCodec ff_aac_encoder = {
     .encode2        = aac_encode_frame,
     .close          = aac_encode_end,
     .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY |
-                      CODEC_CAP_EXPERIMENTAL,
+                      CODEC_CAP_SLICE_THREADS | CODEC_CAP_EXPERIMENTAL,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &aacenc_class,
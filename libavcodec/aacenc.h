@@ -32,8 +32,19 @@
 
 typedef struct AACEncOptions {
     int stereo_mode;
+    int aac_coder;
+    int search_speed;
 } AACEncOptions;
 
+/**
+ * rate/distortion of one band quantized with a given scalefactor
+ */
+typedef struct AACBandCost {
+    int   sf_idx;                                ///< scalefactor index, -1 if unset
+    int   bits;
+    float dist;
+} AACBandCost;
+
 struct AACEncContext;
 
 typedef struct AACCoefficientsEncoder {
@@ -71,9 +82,24 @@ typedef struct AACEncContext {
     int cur_channel;
     int last_frame;
     float lambda;
+    int64_t search_time;                         ///< total time spent in the quantizer search, in microseconds
+    int search_frames;                           ///< number of frames the search time was measured for
     AudioFrameQueue afq;
+
+    void (*abs_pow34)(float *out, const float *in, const int size);
+    void (*quant_bands)(int *out, const float *in, const float *scaled,
+                        int size, int is_signed, int maxval, const float Q34);
+
+    /**
+     * Per-thread copies of the context used for the quantizer search,
+     * NULL unless slice threading is active.
+     * Only the fields above the scratch buffers are copied.
+     */
+    struct AACEncContext *thread_context;
+
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
     DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
+    AACBandCost band_cost[128][16];              ///< band costs cache of the two-loop search, indexed by band and scalefactor
 
     struct {
         float *samples;
@@ -82,4 +108,6 @@ typedef struct AACEncContext {
 
 extern float ff_aac_pow34sf_tab[428];
 
+void ff_aac_dsp_init(AACEncContext *s);
+
 #endif /* AVCODEC_AACENC_H */
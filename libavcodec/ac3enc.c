@@ -486,52 +486,63 @@ static void encode_exponents_blk_ch(uint8_t *exp, int nb_exps, int exp_strategy,
 
 
 /*
- * Encode exponents from original extracted form to what the decoder will see.
- * This copies and groups exponents based on exponent strategy and reduces
- * deltas between adjacent exponent groups so that they can be differentially
- * encoded.
+ * Encode the exponents of all blocks in one channel.
  */
-static void encode_exponents(AC3EncodeContext *s)
+static int encode_exponents_ch(AVCodecContext *avctx, void *arg, int jobnr,
+                               int threadnr)
 {
-    int blk, blk1, ch, cpl;
-    uint8_t *exp, *exp_strategy;
-    int nb_coefs, num_reuse_blocks;
+    AC3EncodeContext *s = avctx->priv_data;
+    int ch  = jobnr + !s->cpl_on;
+    int cpl = (ch == CPL_CH);
+    uint8_t *exp          = s->blocks[0].exp[ch] + s->start_freq[ch];
+    uint8_t *exp_strategy = s->exp_strategy[ch];
+    int blk, blk1, nb_coefs, num_reuse_blocks;
+
+    blk = 0;
+    while (blk < s->num_blocks) {
+        AC3Block *block = &s->blocks[blk];
+        if (cpl && !block->cpl_in_use) {
+            exp += AC3_MAX_COEFS;
+            blk++;
+            continue;
+        }
+        nb_coefs = block->end_freq[ch] - s->start_freq[ch];
+        blk1 = blk + 1;
 
-    for (ch = !s->cpl_on; ch <= s->channels; ch++) {
-        exp          = s->blocks[0].exp[ch] + s->start_freq[ch];
-        exp_strategy = s->exp_strategy[ch];
+        /* count the number of EXP_REUSE blocks after the current block
+           and set exponent reference block numbers */
+        s->exp_ref_block[ch][blk] = blk;
+        while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
+            s->exp_ref_block[ch][blk1] = blk;
+            blk1++;
+        }
+        num_reuse_blocks = blk1 - blk - 1;
 
-        cpl = (ch == CPL_CH);
-        blk = 0;
-        while (blk < s->num_blocks) {
-            AC3Block *block = &s->blocks[blk];
-            if (cpl && !block->cpl_in_use) {
-                exp += AC3_MAX_COEFS;
-                blk++;
-                continue;
-            }
-            nb_coefs = block->end_freq[ch] - s->start_freq[ch];
-            blk1 = blk + 1;
+        /* for the EXP_REUSE case we select the min of the exponents */
+        s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
+                                   AC3_MAX_COEFS);
 
-            /* count the number of EXP_REUSE blocks after the current block
-               and set exponent reference block numbers */
-            s->exp_ref_block[ch][blk] = blk;
-            while (blk1 < s->num_blocks && exp_strategy[blk1] == EXP_REUSE) {
-                s->exp_ref_block[ch][blk1] = blk;
-                blk1++;
-            }
-            num_reuse_blocks = blk1 - blk - 1;
+        encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
 
-            /* for the EXP_REUSE case we select the min of the exponents */
-            s->ac3dsp.ac3_exponent_min(exp-s->start_freq[ch], num_reuse_blocks,
-                                       AC3_MAX_COEFS);
+        exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
+        blk = blk1;
+    }
+    emms_c();
 
-            encode_exponents_blk_ch(exp, nb_coefs, exp_strategy[blk], cpl);
+    return 0;
+}
 
-            exp += AC3_MAX_COEFS * (num_reuse_blocks + 1);
-            blk = blk1;
-        }
-    }
+
+/*
+ * Encode exponents from original extracted form to what the decoder will see.
+ * This copies and groups exponents based on exponent strategy and reduces
+ * deltas between adjacent exponent groups so that they can be differentially
+ * encoded.
+ */
+static void encode_exponents(AC3EncodeContext *s)
+{
+    s->avctx->execute2(s->avctx, encode_exponents_ch, NULL, NULL,
+                       s->channels + s->cpl_on);
 
     /* reference block numbers have been changed, so reset ref_bap_set */
     s->ref_bap_set = 0;
@@ -932,32 +943,46 @@ static void count_frame_bits(AC3EncodeContext *s)
 
 
 /*
- * Calculate masking curve based on the final exponents.
- * Also calculate the power spectral densities to use in future calculations.
+ * Calculate the masking curve of all blocks in one channel.
  */
-static void bit_alloc_masking(AC3EncodeContext *s)
+static int bit_alloc_masking_ch(AVCodecContext *avctx, void *arg, int ch,
+                                int threadnr)
 {
-    int blk, ch;
+    AC3EncodeContext *s = avctx->priv_data;
+    int blk;
 
     for (blk = 0; blk < s->num_blocks; blk++) {
         AC3Block *block = &s->blocks[blk];
-        for (ch = !block->cpl_in_use; ch <= s->channels; ch++) {
-            /* We only need psd and mask for calculating bap.
-               Since we currently do not calculate bap when exponent
-               strategy is EXP_REUSE we do not need to calculate psd or mask. */
-            if (s->exp_strategy[ch][blk] != EXP_REUSE) {
-                ff_ac3_bit_alloc_calc_psd(block->exp[ch], s->start_freq[ch],
-                                          block->end_freq[ch], block->psd[ch],
-                                          block->band_psd[ch]);
-                ff_ac3_bit_alloc_calc_mask(&s->bit_alloc, block->band_psd[ch],
-                                           s->start_freq[ch], block->end_freq[ch],
-                                           ff_ac3_fast_gain_tab[s->fast_gain_code[ch]],
-                                           ch == s->lfe_channel,
-                                           DBA_NONE, 0, NULL, NULL, NULL,
-                                           block->mask[ch]);
-            }
+        if (ch == CPL_CH && !block->cpl_in_use)
+            continue;
+        /* We only need psd and mask for calculating bap.
+           Since we currently do not calculate bap when exponent
+           strategy is EXP_REUSE we do not need to calculate psd or mask. */
+        if (s->exp_strategy[ch][blk] != EXP_REUSE) {
+            ff_ac3_bit_alloc_calc_psd(block->exp[ch], s->start_freq[ch],
+                                      block->end_freq[ch], block->psd[ch],
+                                      block->band_psd[ch]);
+            ff_ac3_bit_alloc_calc_mask(&s->bit_alloc, block->band_psd[ch],
+                                       s->start_freq[ch], block->end_freq[ch],
+                                       ff_ac3_fast_gain_tab[s->fast_gain_code[ch]],
+                                       ch == s->lfe_channel,
+                                       DBA_NONE, 0, NULL, NULL, NULL,
+                                       block->mask[ch]);
         }
     }
+
+    return 0;
+}
+
+
+/*
+ * Calculate masking curve based on the final exponents.
+ * Also calculate the power spectral densities to use in future calculations.
+ */
+static void bit_alloc_masking(AC3EncodeContext *s)
+{
+    s->avctx->execute2(s->avctx, bit_alloc_masking_ch, NULL, NULL,
+                       s->channels + 1);
 }
 
 
@@ -1094,6 +1119,7 @@ static int cbr_bit_allocation(AC3EncodeContext *s)
     int ch;
     int bits_left;
     int snr_offset, snr_incr;
+    int fail_offset = 1024; /* lowest SNR offset known not to fit */
 
     bits_left = 8 * s->frame_size - (s->frame_bits + s->exponent_bits);
     if (bits_left < 0)
@@ -1106,19 +1132,25 @@ static int cbr_bit_allocation(AC3EncodeContext *s)
     if ((snr_offset | s->fine_snr_offset[1]) == 1023) {
         if (bit_alloc(s, 1023) <= bits_left)
             return 0;
+        fail_offset = 1023;
     }
 
     while (snr_offset >= 0 &&
            bit_alloc(s, snr_offset) > bits_left) {
+        fail_offset = snr_offset;
         snr_offset -= 64;
     }
     if (snr_offset < 0)
         return AVERROR(EINVAL);
 
+    /* offsets which already failed are not tried again in the refinement */
     FFSWAP(uint8_t *, s->bap_buffer, s->bap1_buffer);
     for (snr_incr = 64; snr_incr > 0; snr_incr >>= 2) {
-        while (snr_offset + snr_incr <= 1023 &&
-               bit_alloc(s, snr_offset + snr_incr) <= bits_left) {
+        while (snr_offset + snr_incr < fail_offset) {
+            if (bit_alloc(s, snr_offset + snr_incr) > bits_left) {
+                fail_offset = snr_offset + snr_incr;
+                break;
+            }
             snr_offset += snr_incr;
             FFSWAP(uint8_t *, s->bap_buffer, s->bap1_buffer);
         }
@@ -2472,6 +2504,9 @@ av_cold int ff_ac3_encode_init(AVCodecContext *avctx)
 
     bit_alloc_init(s);
 
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ?
+                    avctx->thread_count : 1;
+
     ret = s->mdct_init(s);
     if (ret)
         goto init_fail;
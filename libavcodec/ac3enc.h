@@ -164,7 +164,7 @@ typedef struct AC3EncodeContext {
     DSPContext dsp;
     AVFloatDSPContext fdsp;
     AC3DSPContext ac3dsp;                   ///< AC-3 optimized functions
-    FFTContext mdct;                        ///< FFT context for MDCT calculation
+    FFTContext *mdct;                       ///< FFT contexts for MDCT calculation, one per slice thread
     const SampleType *mdct_window;          ///< MDCT window function array
 
     AC3Block blocks[AC3_MAX_BLOCKS];        ///< per-block info
@@ -229,7 +229,8 @@ typedef struct AC3EncodeContext {
     int frame_bits;                         ///< all frame bits except exponents and mantissas
     int exponent_bits;                      ///< number of bits used for exponents
 
-    SampleType *windowed_samples;
+    int nb_threads;                         ///< number of slice threads
+    SampleType *windowed_samples;           ///< one window per slice thread
     SampleType **planar_samples;
     uint8_t *bap_buffer;
     uint8_t *bap1_buffer;
@@ -47,7 +47,12 @@ static const AVClass ac3enc_class = { "Fixed-Point AC-3 Encoder", av_default_ite
  */
 av_cold void AC3_NAME(mdct_end)(AC3EncodeContext *s)
 {
-    ff_mdct_end(&s->mdct);
+    int i;
+
+    if (s->mdct)
+        for (i = 0; i < s->nb_threads; i++)
+            ff_mdct_end(&s->mdct[i]);
+    av_freep(&s->mdct);
 }
 
 
@@ -59,9 +64,19 @@ av_cold void AC3_NAME(mdct_end)(AC3EncodeContext *s)
  */
 av_cold int AC3_NAME(mdct_init)(AC3EncodeContext *s)
 {
-    int ret = ff_mdct_init(&s->mdct, 9, 0, -1.0);
+    int i, ret;
+
     s->mdct_window = ff_ac3_window;
-    return ret;
+
+    s->mdct = av_mallocz(s->nb_threads * sizeof(*s->mdct));
+    if (!s->mdct)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_threads; i++) {
+        ret = ff_mdct_init(&s->mdct[i], 9, 0, -1.0);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
 }
 
 
@@ -69,12 +84,12 @@ av_cold int AC3_NAME(mdct_init)(AC3EncodeContext *s)
  * Normalize the input samples to use the maximum available precision.
  * This assumes signed 16-bit input samples.
  */
-static int normalize_samples(AC3EncodeContext *s)
+static int normalize_samples(AC3EncodeContext *s, int16_t *samples)
 {
-    int v = s->ac3dsp.ac3_max_msb_abs_int16(s->windowed_samples, AC3_WINDOW_SIZE);
+    int v = s->ac3dsp.ac3_max_msb_abs_int16(samples, AC3_WINDOW_SIZE);
     v = 14 - av_log2(v);
     if (v > 0)
-        s->ac3dsp.ac3_lshift_int16(s->windowed_samples, AC3_WINDOW_SIZE, v);
+        s->ac3dsp.ac3_lshift_int16(samples, AC3_WINDOW_SIZE, v);
     /* +6 to right-shift from 31-bit to 25-bit */
     return v + 6;
 }
@@ -139,6 +154,7 @@ AVCodec ff_ac3_fixed_encoder = {
     .init            = ac3_fixed_encode_init,
     .encode2         = ff_ac3_fixed_encode_frame,
     .close           = ff_ac3_encode_close,
+    .capabilities    = CODEC_CAP_SLICE_THREADS,
     .sample_fmts     = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16P,
                                                       AV_SAMPLE_FMT_NONE },
     .priv_class      = &ac3enc_class,
@@ -50,7 +50,12 @@ static const AVClass ac3enc_class = { "AC-3 Encoder", av_default_item_name,
  */
 av_cold void ff_ac3_float_mdct_end(AC3EncodeContext *s)
 {
-    ff_mdct_end(&s->mdct);
+    int i;
+
+    if (s->mdct)
+        for (i = 0; i < s->nb_threads; i++)
+            ff_mdct_end(&s->mdct[i]);
+    av_freep(&s->mdct);
     av_freep(&s->mdct_window);
 }
 
@@ -64,7 +69,7 @@ av_cold void ff_ac3_float_mdct_end(AC3EncodeContext *s)
 av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
 {
     float *window;
-    int i, n, n2;
+    int i, n, n2, ret;
 
     n  = 1 << 9;
     n2 = n >> 1;
@@ -79,7 +84,15 @@ av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
         window[n-1-i] = window[i];
     s->mdct_window = window;
 
-    return ff_mdct_init(&s->mdct, 9, 0, -2.0 / n);
+    s->mdct = av_mallocz(s->nb_threads * sizeof(*s->mdct));
+    if (!s->mdct)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_threads; i++) {
+        ret = ff_mdct_init(&s->mdct[i], 9, 0, -2.0 / n);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
 }
 
 
@@ -87,7 +100,7 @@ av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
  * Normalize the input samples.
  * Not needed for the floating-point encoder.
  */
-static int normalize_samples(AC3EncodeContext *s)
+static int normalize_samples(AC3EncodeContext *s, float *samples)
 {
     return 0;
 }
@@ -137,6 +150,7 @@ AVCodec ff_ac3_encoder = {
     .init            = ff_ac3_encode_init,
     .encode2         = ff_ac3_float_encode_frame,
     .close           = ff_ac3_encode_close,
+    .capabilities    = CODEC_CAP_SLICE_THREADS,
     .sample_fmts     = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                       AV_SAMPLE_FMT_NONE },
     .priv_class      = &ac3enc_class,
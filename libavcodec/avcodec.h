@@ -2764,6 +2764,19 @@ typedef struct AVCodecContext {
      * - decoding: unused.
      */
     uint64_t vbv_delay;
+
+    /**
+     * Maximum number of frames of delay added by frame threading, 0 for no
+     * limit. When thread_count is larger than frame_thread_delay + 1, only
+     * frame_thread_delay + 1 frames are decoded at once and, if thread_type
+     * also contains FF_THREAD_SLICE and the decoder supports it (currently
+     * only the H.264 decoder), the remaining threads are shared out between
+     * them to decode parts of each frame in parallel, up to the number of
+     * parts the decoder can use.
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    int frame_thread_delay;
 } AVCodecContext;
 
 /**
@@ -2841,6 +2854,12 @@ typedef struct AVCodec {
     int (*update_thread_context)(AVCodecContext *dst, const AVCodecContext *src);
     /** @} */
 
+    /**
+     * Internal codec capabilities.
+     * See FF_CODEC_CAP_* in internal.h
+     */
+    int caps_internal;
+
     /**
      * Private codec-specific defaults.
      */
@@ -4191,6 +4210,22 @@ int avcodec_fill_audio_frame(AVFrame *frame, int nb_channels,
  */
 void avcodec_flush_buffers(AVCodecContext *avctx);
 
+/**
+ * Reinitialize an opened decoder so that it can decode a new stream.
+ *
+ * This is cheaper than closing and opening the context again: the context
+ * internals, the slice and frame threads and the frame buffer pools are kept,
+ * only the decoder itself is reinitialized. The caller may update the stream
+ * parameters in avctx (e.g. extradata, width, height) before calling this
+ * function. The decoder private options keep their current values.
+ *
+ * @param avctx an opened decoder context
+ * @return 0 on success, a negative AVERROR code on failure. On failure the
+ *         decoder is freed and the context is closed, as if avcodec_close()
+ *         had been called; it can be opened again with avcodec_open2().
+ */
+int avcodec_reset(AVCodecContext *avctx);
+
 /**
  * Return codec bits per sample.
  *
@@ -4225,6 +4260,12 @@ typedef struct AVBitStreamFilterContext {
     struct AVBitStreamFilter *filter;
     AVCodecParserContext *parser;
     struct AVBitStreamFilterContext *next;
+    /**
+     * Pools of output buffers used by av_bitstream_filter_filter_packet(),
+     * one per power of two size class starting at 1 KiB.
+     * Private to libavcodec.
+     */
+    AVBufferPool *pools[20];
 } AVBitStreamFilterContext;
 
 
@@ -4237,6 +4278,16 @@ typedef struct AVBitStreamFilter {
                   const uint8_t *buf, int buf_size, int keyframe);
     void (*close)(AVBitStreamFilterContext *bsfc);
     struct AVBitStreamFilter *next;
+    /**
+     * Optional, filter a packet into a reference-counted packet.
+     * New data is written in buffers from ff_bsf_get_buffer().
+     *
+     * @return 0 if the packet is passed through unchanged and out is left
+     *         untouched, 1 if out was set, a negative AVERROR code on failure
+     */
+    int (*filter_packet)(AVBitStreamFilterContext *bsfc,
+                         AVCodecContext *avctx, const char *args,
+                         AVPacket *out, const AVPacket *in);
 } AVBitStreamFilter;
 
 void av_register_bitstream_filter(AVBitStreamFilter *bsf);
@@ -4245,6 +4296,22 @@ int av_bitstream_filter_filter(AVBitStreamFilterContext *bsfc,
                                AVCodecContext *avctx, const char *args,
                                uint8_t **poutbuf, int *poutbuf_size,
                                const uint8_t *buf, int buf_size, int keyframe);
+
+/**
+ * Filter a packet in place, like av_bitstream_filter_filter().
+ *
+ * When the filter produces new data, the packet is given a
+ * reference-counted buffer taken from pools owned by bsfc, so that
+ * filters supporting it allocate nothing per packet once the pools hold
+ * enough buffers. The packet properties and side data are kept.
+ *
+ * @param pkt the packet to filter, replaced by the filtered packet on
+ *            success and left untouched on failure
+ * @return >= 0 on success, a negative AVERROR code on failure
+ */
+int av_bitstream_filter_filter_packet(AVBitStreamFilterContext *bsfc,
+                                      AVCodecContext *avctx, const char *args,
+                                      AVPacket *pkt);
 void av_bitstream_filter_close(AVBitStreamFilterContext *bsf);
 
 AVBitStreamFilter *av_bitstream_filter_next(AVBitStreamFilter *f);
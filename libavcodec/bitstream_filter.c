@@ -18,9 +18,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdint.h>
 #include <string.h>
 
 #include "avcodec.h"
+#include "internal.h"
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
 #include "libavutil/mem.h"
 
 static AVBitStreamFilter *first_bitstream_filter = NULL;
@@ -59,9 +64,13 @@ AVBitStreamFilterContext *av_bitstream_filter_init(const char *name)
 
 void av_bitstream_filter_close(AVBitStreamFilterContext *bsfc)
 {
+    int i;
+
     if (bsfc->filter->close)
         bsfc->filter->close(bsfc);
     av_freep(&bsfc->priv_data);
+    for (i = 0; i < FF_ARRAY_ELEMS(bsfc->pools); i++)
+        av_buffer_pool_uninit(&bsfc->pools[i]);
     av_parser_close(bsfc->parser);
     av_free(bsfc);
 }
@@ -76,3 +85,86 @@ int av_bitstream_filter_filter(AVBitStreamFilterContext *bsfc,
     return bsfc->filter->filter(bsfc, avctx, args, poutbuf, poutbuf_size,
                                 buf, buf_size, keyframe);
 }
+
+int ff_bsf_get_buffer(AVBitStreamFilterContext *bsfc, AVPacket *pkt, int size)
+{
+    int i = 0;
+
+    if (size < 0 || size > INT_MAX - FF_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR(EINVAL);
+
+    /* Take the buffer from the pool of its size class, so that small
+     * packets do not hold buffers sized for the largest one. */
+    while (i < FF_ARRAY_ELEMS(bsfc->pools) &&
+           1024 << i < size + FF_INPUT_BUFFER_PADDING_SIZE)
+        i++;
+
+    if (i < FF_ARRAY_ELEMS(bsfc->pools)) {
+        if (!bsfc->pools[i]) {
+            bsfc->pools[i] = av_buffer_pool_init(1024 << i, NULL);
+            if (!bsfc->pools[i])
+                return AVERROR(ENOMEM);
+        }
+        pkt->buf = av_buffer_pool_get(bsfc->pools[i]);
+    } else {
+        pkt->buf = av_buffer_alloc(size + FF_INPUT_BUFFER_PADDING_SIZE);
+    }
+    if (!pkt->buf)
+        return AVERROR(ENOMEM);
+    pkt->data = pkt->buf->data;
+    pkt->size = size;
+    memset(pkt->data + size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    return 0;
+}
+
+int av_bitstream_filter_filter_packet(AVBitStreamFilterContext *bsfc,
+                                      AVCodecContext *avctx, const char *args,
+                                      AVPacket *pkt)
+{
+    AVPacket out = *pkt, in;
+    int ret;
+
+    if (bsfc->filter->filter_packet) {
+        out.buf = NULL;
+        ret = bsfc->filter->filter_packet(bsfc, avctx, args, &out, pkt);
+        if (ret <= 0)
+            return ret;
+    } else {
+        ret = av_bitstream_filter_filter(bsfc, avctx, args,
+                                         &out.data, &out.size,
+                                         pkt->data, pkt->size,
+                                         pkt->flags & AV_PKT_FLAG_KEY);
+        if (ret < 0)
+            return ret;
+        if (!ret) {
+            /* the output points into the input buffer */
+            pkt->data = out.data;
+            pkt->size = out.size;
+            return 0;
+        }
+        out.buf = av_buffer_create(out.data, out.size,
+                                   av_buffer_default_free, NULL, 0);
+        if (!out.buf) {
+            av_free(out.data);
+            return AVERROR(ENOMEM);
+        }
+    }
+
+    /* release the input data, but keep the side data */
+    in                 = *pkt;
+    in.side_data       = NULL;
+    in.side_data_elems = 0;
+    av_free_packet(&in);
+
+    pkt->buf  = out.buf;
+    pkt->data = out.data;
+    pkt->size = out.size;
+#if FF_API_DESTRUCT_PACKET
+FF_DISABLE_DEPRECATION_WARNINGS
+    pkt->destruct = NULL;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+
+    return ret;
+}
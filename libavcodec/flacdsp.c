@@ -85,9 +85,21 @@ static void flac_lpc_32_c(int32_t *decoded, const int coeffs[32],
 
 }
 
+static uint64_t flac_rice_sum_c(const int32_t *res, int len)
+{
+    uint64_t sum = 0;
+    int i;
+
+    for (i = 0; i < len; i++)
+        sum += (2U * res[i]) ^ (res[i] >> 31);
+    return sum;
+}
+
 av_cold void ff_flacdsp_init(FLACDSPContext *c, enum AVSampleFormat fmt,
                              int bps)
 {
+    c->rice_sum = flac_rice_sum_c;
+
     if (bps > 16) {
         c->lpc            = flac_lpc_32_c;
         c->lpc_encode     = flac_lpc_encode_c_32;
@@ -29,6 +29,11 @@ typedef struct FLACDSPContext {
                 int qlevel, int len);
     void (*lpc_encode)(int32_t *res, const int32_t *smp, int len, int order,
                        const int32_t *coefs, int shift);
+    /**
+     * Sum the residuals mapped to unsigned values as done for Rice coding.
+     * @param len number of residuals, must be a multiple of 4
+     */
+    uint64_t (*rice_sum)(const int32_t *res, int len);
 } FLACDSPContext;
 
 void ff_flacdsp_init(FLACDSPContext *c, enum AVSampleFormat fmt, int bps);
@@ -78,8 +78,9 @@ typedef struct FlacSubframe {
     int32_t coefs[MAX_LPC_ORDER];
     int shift;
     RiceContext rc;
-    int32_t samples[FLAC_MAX_BLOCKSIZE];
-    int32_t residual[FLAC_MAX_BLOCKSIZE+1];
+    /* the SIMD residual functions process 4 samples at a time */
+    int32_t samples[FLAC_MAX_BLOCKSIZE + 3];
+    int32_t residual[FLAC_MAX_BLOCKSIZE + 3];
 } FlacSubframe;
 
 typedef struct FlacFrame {
@@ -108,7 +109,8 @@ typedef struct FlacEncodeContext {
     FlacFrame frame;
     CompressionOptions options;
     AVCodecContext *avctx;
-    LPCContext lpc_ctx;
+    LPCContext *lpc_ctx;        ///< one per slice thread
+    int nb_lpc_ctx;
     struct AVMD5 *md5ctx;
     uint8_t *md5_buffer;
     unsigned int md5_buffer_size;
@@ -394,8 +396,18 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
     s->frame_count   = 0;
     s->min_framesize = s->max_framesize;
 
-    ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
-                      s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    s->nb_lpc_ctx = avctx->active_thread_type & FF_THREAD_SLICE ?
+                    avctx->thread_count : 1;
+    s->lpc_ctx = av_mallocz(s->nb_lpc_ctx * sizeof(*s->lpc_ctx));
+    if (!s->lpc_ctx)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->nb_lpc_ctx; i++) {
+        ret = ff_lpc_init(&s->lpc_ctx[i], avctx->frame_size,
+                          s->options.max_prediction_order,
+                          FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
 
     ff_dsputil_init(&s->dsp, avctx);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt,
@@ -579,23 +591,25 @@ static uint64_t calc_optimal_rice_params(RiceContext *rc, int porder,
 }
 
 
-static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
+static void calc_sums(FLACDSPContext *dsp, int pmin, int pmax,
+                      const int32_t *data, int n, int pred_order,
                       uint64_t sums[][MAX_PARTITIONS])
 {
     int i, j;
     int parts;
-    uint32_t *res, *res_end;
+    const int32_t *res = &data[pred_order];
+    int len            = (n >> pmax) - pred_order;
 
     /* sums for highest level */
-    parts   = (1 << pmax);
-    res     = &data[pred_order];
-    res_end = &data[n >> pmax];
+    parts = (1 << pmax);
     for (i = 0; i < parts; i++) {
-        uint64_t sum = 0;
-        while (res < res_end)
-            sum += *(res++);
+        int len4     = len & ~3;
+        uint64_t sum = dsp->rice_sum(res, len4);
+        for (j = len4; j < len; j++)
+            sum += (2U * res[j]) ^ (res[j] >> 31);
         sums[pmax][i] = sum;
-        res_end += n >> pmax;
+        res += len;
+        len  = n >> pmax;
     }
     /* sums for lower levels */
     for (i = pmax - 1; i >= pmin; i--) {
@@ -606,14 +620,14 @@ static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
 }
 
 
-static uint64_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
-                                 int32_t *data, int n, int pred_order)
+static uint64_t calc_rice_params(FLACDSPContext *dsp, RiceContext *rc,
+                                 int pmin, int pmax, const int32_t *data,
+                                 int n, int pred_order)
 {
     int i;
     uint64_t bits[MAX_PARTITION_ORDER+1];
     int opt_porder;
     RiceContext tmp_rc;
-    uint32_t *udata;
     uint64_t sums[MAX_PARTITION_ORDER+1][MAX_PARTITIONS];
 
     assert(pmin >= 0 && pmin <= MAX_PARTITION_ORDER);
@@ -622,11 +636,7 @@ static uint64_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
 
     tmp_rc.coding_mode = rc->coding_mode;
 
-    udata = av_malloc(n * sizeof(uint32_t));
-    for (i = 0; i < n; i++)
-        udata[i] = (2*data[i]) ^ (data[i]>>31);
-
-    calc_sums(pmin, pmax, udata, n, pred_order, sums);
+    calc_sums(dsp, pmin, pmax, data, n, pred_order, sums);
 
     opt_porder = pmin;
     bits[pmin] = UINT32_MAX;
@@ -638,7 +648,6 @@ static uint64_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
         }
     }
 
-    av_freep(&udata);
     return bits[opt_porder];
 }
 
@@ -663,8 +672,8 @@ static uint64_t find_subframe_rice_params(FlacEncodeContext *s,
     uint64_t bits = 8 + pred_order * sub->obits + 2 + sub->rc.coding_mode;
     if (sub->type == FLAC_SUBFRAME_LPC)
         bits += 4 + 5 + pred_order * s->options.lpc_coeff_precision;
-    bits += calc_rice_params(&sub->rc, pmin, pmax, sub->residual,
-                             s->frame.blocksize, pred_order);
+    bits += calc_rice_params(&s->flac_dsp, &sub->rc, pmin, pmax,
+                             sub->residual, s->frame.blocksize, pred_order);
     return bits;
 }
 
@@ -720,7 +729,8 @@ static void encode_residual_fixed(int32_t *res, const int32_t *smp, int n,
 }
 
 
-static int encode_residual_ch(FlacEncodeContext *s, int ch)
+static int encode_residual_ch(FlacEncodeContext *s, LPCContext *lpc_ctx,
+                              int ch)
 {
     int i, n;
     int min_order, max_order, opt_order, omethod;
@@ -783,7 +793,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
 
     /* LPC */
     sub->type = FLAC_SUBFRAME_LPC;
-    opt_order = ff_lpc_calc_coefs(&s->lpc_ctx, smp, n, min_order, max_order,
+    opt_order = ff_lpc_calc_coefs(lpc_ctx, smp, n, min_order, max_order,
                                   s->options.lpc_coeff_precision, coefs, shift, s->options.lpc_type,
                                   s->options.lpc_passes, omethod,
                                   MAX_LPC_SHIFT, 0);
@@ -895,15 +905,30 @@ static int count_frame_header(FlacEncodeContext *s)
 }
 
 
+static int encode_residual_thread(AVCodecContext *avctx, void *arg,
+                                  int ch, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    int *counts          = arg;
+
+    counts[ch] = encode_residual_ch(s, &s->lpc_ctx[threadnr], ch);
+    return 0;
+}
+
+
 static int encode_frame(FlacEncodeContext *s)
 {
     int ch;
+    int counts[FLAC_MAX_CHANNELS];
     uint64_t count;
 
     count = count_frame_header(s);
 
+    /* the channels are independent once the stereo mode is chosen */
+    s->avctx->execute2(s->avctx, encode_residual_thread, counts, NULL,
+                       s->channels);
     for (ch = 0; ch < s->channels; ch++)
-        count += encode_residual_ch(s, ch);
+        count += counts[ch];
 
     count += (8 - (count & 7)) & 7; // byte alignment
     count += 16;                    // CRC-16
@@ -1273,9 +1298,13 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     if (avctx->priv_data) {
         FlacEncodeContext *s = avctx->priv_data;
+        int i;
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
-        ff_lpc_end(&s->lpc_ctx);
+        if (s->lpc_ctx)
+            for (i = 0; i < s->nb_lpc_ctx; i++)
+                ff_lpc_end(&s->lpc_ctx[i]);
+        av_freep(&s->lpc_ctx);
     }
     av_freep(&avctx->extradata);
     avctx->extradata_size = 0;
@@ -1325,7 +1354,8 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY |
+                      CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
@@ -50,6 +50,22 @@
 #define UNCHECKED_BITSTREAM_READER !CONFIG_SAFE_BITSTREAM_READER
 #endif
 
+/*
+ * Cached bitstream reading:
+ * decoders that read many symbols within one OPEN_READER/CLOSE_READER
+ * block can "#define CACHED_BITSTREAM_READER" before including this
+ * header. The reader then keeps a 64-bit cache together with a count of
+ * the valid bits in it, and UPDATE_CACHE only reloads from the buffer once
+ * fewer than MIN_CACHE_BITS bits are left, instead of on every call.
+ * The cache only lives between OPEN_READER and CLOSE_READER, so the
+ * GetBitContext layout and the state kept in it are the same for all
+ * readers and a context can be shared with code built without it.
+ * It is ignored on targets without fast 64-bit arithmetic.
+ */
+#if defined(CACHED_BITSTREAM_READER) && !HAVE_FAST_64BIT
+#undef CACHED_BITSTREAM_READER
+#endif
+
 typedef struct GetBitContext {
     const uint8_t *buffer, *buffer_end;
     int index;
@@ -89,6 +105,8 @@ typedef struct RL_VLC_ELEM {
  * UPDATE_CACHE(name, gb)
  *   Refill the internal cache from the bitstream.
  *   After this call at least MIN_CACHE_BITS will be available.
+ *   With CACHED_BITSTREAM_READER this is a no-op while enough bits
+ *   are left in the cache.
  *
  * GET_CACHE(name, gb)
  *   Will output the contents of the internal cache,
@@ -107,6 +125,8 @@ typedef struct RL_VLC_ELEM {
  * SKIP_CACHE(name, gb, num)
  *   Will remove the next num bits from the cache (note SKIP_COUNTER
  *   MUST be called before UPDATE_CACHE / CLOSE_READER).
+ *   With CACHED_BITSTREAM_READER, all the bits passed to SKIP_COUNTER
+ *   must also have been removed from the cache by then.
  *
  * SKIP_COUNTER(name, gb, num)
  *   Will increment the internal bit counter (see SKIP_CACHE & SKIP_BITS).
@@ -117,22 +137,31 @@ typedef struct RL_VLC_ELEM {
  * For examples see get_bits, show_bits, skip_bits, get_vlc.
  */
 
-#ifdef LONG_BITSTREAM_READER
+#if defined(LONG_BITSTREAM_READER) || defined(CACHED_BITSTREAM_READER)
 #   define MIN_CACHE_BITS 32
 #else
 #   define MIN_CACHE_BITS 25
 #endif
 
+#ifdef CACHED_BITSTREAM_READER
+#define OPEN_READER_CACHE(name)                 \
+    uint64_t av_unused name ## _cache = 0;      \
+    int      av_unused name ## _bits  = 0
+#else
+#define OPEN_READER_CACHE(name)                 \
+    unsigned int av_unused name ## _cache = 0
+#endif
+
 #if UNCHECKED_BITSTREAM_READER
 #define OPEN_READER(name, gb)                   \
     unsigned int name ## _index = (gb)->index;  \
-    unsigned int av_unused name ## _cache = 0
+    OPEN_READER_CACHE(name)
 
 #define HAVE_BITS_REMAINING(name, gb) 1
 #else
 #define OPEN_READER(name, gb)                   \
     unsigned int name ## _index = (gb)->index;  \
-    unsigned int av_unused name ## _cache = 0;  \
+    OPEN_READER_CACHE(name);                    \
     unsigned int av_unused name ## _size_plus8 = (gb)->size_in_bits_plus8
 
 #define HAVE_BITS_REMAINING(name, gb) name ## _index < name ## _size_plus8
@@ -140,7 +169,42 @@ typedef struct RL_VLC_ELEM {
 
 #define CLOSE_READER(name, gb) (gb)->index = name ## _index
 
-#ifdef BITSTREAM_READER_LE
+#ifdef CACHED_BITSTREAM_READER
+
+/* A refill loads 8 bytes, so it may only start up to buffer_end to stay
+ * within FF_INPUT_BUFFER_PADDING_SIZE. The index can go past that (by one
+ * byte in the checked reader, without bound in the unchecked one), but then
+ * only zero padding is left to read, so the cache is cleared instead. */
+# define CACHE_POS_VALID(name, gb) \
+    (name ## _index >> 3) <= (gb)->buffer_end - (gb)->buffer
+
+# ifdef BITSTREAM_READER_LE
+#   define REFILL_CACHE(name, gb) name ## _cache = \
+        CACHE_POS_VALID(name, gb) ?                                         \
+        AV_RL64((gb)->buffer + (name ## _index >> 3)) >> (name ## _index & 7) : 0
+#   define SKIP_CACHE_BITS(name, gb, num) name ## _cache >>= (num)
+# else
+#   define REFILL_CACHE(name, gb) name ## _cache = \
+        CACHE_POS_VALID(name, gb) ?                                         \
+        AV_RB64((gb)->buffer + (name ## _index >> 3)) << (name ## _index & 7) : 0
+#   define SKIP_CACHE_BITS(name, gb, num) name ## _cache <<= (num)
+# endif
+
+# define UPDATE_CACHE(name, gb)                                 \
+    do {                                                        \
+        if (name ## _bits < MIN_CACHE_BITS) {                   \
+            REFILL_CACHE(name, gb);                             \
+            name ## _bits = 64 - (name ## _index & 7);          \
+        }                                                       \
+    } while (0)
+
+# define SKIP_CACHE(name, gb, num)                              \
+    do {                                                        \
+        SKIP_CACHE_BITS(name, gb, num);                         \
+        name ## _bits -= (num);                                 \
+    } while (0)
+
+#elif defined(BITSTREAM_READER_LE)
 
 # ifdef LONG_BITSTREAM_READER
 #   define UPDATE_CACHE(name, gb) name ## _cache = \
@@ -179,17 +243,31 @@ typedef struct RL_VLC_ELEM {
         SKIP_COUNTER(name, gb, num);            \
     } while (0)
 
-#define LAST_SKIP_BITS(name, gb, num) SKIP_COUNTER(name, gb, num)
+#ifdef CACHED_BITSTREAM_READER
+/* the cache is not reloaded unconditionally, so it has to be kept in sync */
+#   define LAST_SKIP_BITS(name, gb, num) SKIP_BITS(name, gb, num)
+#else
+#   define LAST_SKIP_BITS(name, gb, num) SKIP_COUNTER(name, gb, num)
+#endif
 
 #ifdef BITSTREAM_READER_LE
 #   define SHOW_UBITS(name, gb, num) zero_extend(name ## _cache, num)
 #   define SHOW_SBITS(name, gb, num) sign_extend(name ## _cache, num)
+#elif defined(CACHED_BITSTREAM_READER)
+#   define SHOW_UBITS(name, gb, num) \
+        ((uint32_t)(name ## _cache >> (64 - (num))))
+#   define SHOW_SBITS(name, gb, num) \
+        ((int32_t)((int64_t)name ## _cache >> (64 - (num))))
 #else
 #   define SHOW_UBITS(name, gb, num) NEG_USR32(name ## _cache, num)
 #   define SHOW_SBITS(name, gb, num) NEG_SSR32(name ## _cache, num)
 #endif
 
-#define GET_CACHE(name, gb) ((uint32_t) name ## _cache)
+#if defined(CACHED_BITSTREAM_READER) && !defined(BITSTREAM_READER_LE)
+#   define GET_CACHE(name, gb) ((uint32_t)(name ## _cache >> 32))
+#else
+#   define GET_CACHE(name, gb) ((uint32_t) name ## _cache)
+#endif
 
 static inline int get_bits_count(const GetBitContext *s)
 {
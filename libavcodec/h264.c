@@ -358,10 +358,14 @@ void ff_h264_free_tables(H264Context *h, int free_rbsp)
     av_freep(&h->mb2b_xy);
     av_freep(&h->mb2br_xy);
 
-    av_buffer_pool_uninit(&h->qscale_table_pool);
-    av_buffer_pool_uninit(&h->mb_type_pool);
-    av_buffer_pool_uninit(&h->motion_val_pool);
-    av_buffer_pool_uninit(&h->ref_index_pool);
+    /* on reinit, the pools are kept as long as their buffers still fit,
+     * see init_table_pools() */
+    if (free_rbsp) {
+        av_buffer_pool_uninit(&h->qscale_table_pool);
+        av_buffer_pool_uninit(&h->mb_type_pool);
+        av_buffer_pool_uninit(&h->motion_val_pool);
+        av_buffer_pool_uninit(&h->ref_index_pool);
+    }
 
     if (free_rbsp && h->DPB) {
         for (i = 0; i < H264_MAX_PICTURE_COUNT; i++)
@@ -1790,6 +1794,7 @@ av_cold void ff_h264_free_context(H264Context *h)
     int i;
 
     ff_h264_free_tables(h, 1); // FIXME cleanup init stuff perhaps
+    av_freep(&h->deblock_ctx);
 
     for (i = 0; i < MAX_SPS_COUNT; i++)
         av_freep(h->sps_buffers + i);
@@ -1841,5 +1846,6 @@ AVCodec ff_h264_decoder = {
     .flush                 = flush_dpb,
     .init_thread_copy      = ONLY_IF_THREADS_ENABLED(decode_init_thread_copy),
     .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_h264_update_thread_context),
+    .caps_internal         = FF_CODEC_CAP_FRAME_SLICE_THREADS,
     .profiles              = NULL_IF_CONFIG_SMALL(profiles),
 };
@@ -606,6 +606,17 @@ typedef struct H264Context {
      */
     int single_decode_warning;
 
+    /**
+     * Set when a slice decoded by a single context is loop filtered by
+     * another slice thread, one MB row behind the decoding.
+     * 1 in the decoding context, which only backs up the unfiltered MB
+     * borders, 2 in deblock_ctx, which only filters.
+     */
+    int deblock_thread;
+    struct H264Context *deblock_ctx;
+    int deblock_end_x;  ///< MBs of the last decoded row to filter at the end of the slice
+    int deblock_end_y;  ///< first MB row not completely decoded
+
     enum AVPictureType pict_type;
 
     int last_slice_type;
@@ -695,6 +706,7 @@ typedef struct H264Context {
     AVBufferPool *mb_type_pool;
     AVBufferPool *motion_val_pool;
     AVBufferPool *ref_index_pool;
+    int pools_mb_width, pools_mb_height; ///< dimensions the pools were allocated for
 
     /* Motion Estimation */
     qpel_mc_func (*qpel_put)[16];
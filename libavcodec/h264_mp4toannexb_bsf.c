@@ -24,6 +24,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 #include "avcodec.h"
+#include "internal.h"
 
 typedef struct H264BSFContext {
     uint8_t  length_size;
@@ -31,34 +32,6 @@ typedef struct H264BSFContext {
     int      extradata_parsed;
 } H264BSFContext;
 
-static int alloc_and_copy(uint8_t **poutbuf, int *poutbuf_size,
-                          const uint8_t *sps_pps, uint32_t sps_pps_size,
-                          const uint8_t *in, uint32_t in_size)
-{
-    uint32_t offset         = *poutbuf_size;
-    uint8_t nal_header_size = offset ? 3 : 4;
-    int err;
-
-    *poutbuf_size += sps_pps_size + in_size + nal_header_size;
-    if ((err = av_reallocp(poutbuf,
-                           *poutbuf_size + FF_INPUT_BUFFER_PADDING_SIZE)) < 0) {
-        *poutbuf_size = 0;
-        return err;
-    }
-    if (sps_pps)
-        memcpy(*poutbuf + offset, sps_pps, sps_pps_size);
-    memcpy(*poutbuf + sps_pps_size + nal_header_size + offset, in, in_size);
-    if (!offset) {
-        AV_WB32(*poutbuf + sps_pps_size, 1);
-    } else {
-        (*poutbuf + offset + sps_pps_size)[0] =
-        (*poutbuf + offset + sps_pps_size)[1] = 0;
-        (*poutbuf + offset + sps_pps_size)[2] = 1;
-    }
-
-    return 0;
-}
-
 static int h264_extradata_to_annexb(AVCodecContext *avctx, const int padding)
 {
     uint16_t unit_size;
@@ -128,41 +101,48 @@ static int h264_extradata_to_annexb(AVCodecContext *avctx, const int padding)
     return length_size;
 }
 
-static int h264_mp4toannexb_filter(AVBitStreamFilterContext *bsfc,
-                                   AVCodecContext *avctx, const char *args,
-                                   uint8_t **poutbuf, int *poutbuf_size,
-                                   const uint8_t *buf, int buf_size,
-                                   int keyframe)
+static int parse_extradata(H264BSFContext *ctx, AVCodecContext *avctx)
 {
-    H264BSFContext *ctx = bsfc->priv_data;
-    uint8_t unit_type;
-    int32_t nal_size;
-    uint32_t cumul_size    = 0;
-    const uint8_t *buf_end = buf + buf_size;
-    int ret = 0;
+    int ret;
 
-    /* nothing to filter */
-    if (!avctx->extradata || avctx->extradata_size < 6) {
-        *poutbuf      = (uint8_t *)buf;
-        *poutbuf_size = buf_size;
+    if (ctx->extradata_parsed)
         return 0;
-    }
 
     /* retrieve sps and pps NAL units from extradata */
-    if (!ctx->extradata_parsed) {
-        ret = h264_extradata_to_annexb(avctx, FF_INPUT_BUFFER_PADDING_SIZE);
-        if (ret < 0)
-            return ret;
-        ctx->length_size      = ret;
-        ctx->first_idr        = 1;
-        ctx->extradata_parsed = 1;
-    }
+    ret = h264_extradata_to_annexb(avctx, FF_INPUT_BUFFER_PADDING_SIZE);
+    if (ret < 0)
+        return ret;
+    ctx->length_size      = ret;
+    ctx->first_idr        = 1;
+    ctx->extradata_parsed = 1;
+
+    return 0;
+}
+
+/**
+ * Convert the NAL units of a packet to Annex B.
+ *
+ * @param out output buffer, NULL to only compute the size of the output
+ *            without updating the filter state
+ * @return the size of the output, a negative AVERROR code on failure
+ */
+static int convert_packet(H264BSFContext *ctx, AVCodecContext *avctx,
+                          uint8_t *out, const uint8_t *buf, int buf_size)
+{
+    const uint8_t *buf_end = buf + buf_size;
+    int first_idr          = ctx->first_idr;
+    uint32_t cumul_size    = 0;
+    int64_t out_size       = 0;
 
-    *poutbuf_size = 0;
-    *poutbuf      = NULL;
     do {
+        const uint8_t *sps_pps = NULL;
+        int sps_pps_size       = 0;
+        int nal_header_size    = out_size ? 3 : 4;
+        uint8_t unit_type;
+        int32_t nal_size;
+
         if (buf + ctx->length_size > buf_end)
-            goto fail;
+            return AVERROR(EINVAL);
 
         if (ctx->length_size == 1) {
             nal_size = buf[0];
@@ -175,37 +155,113 @@ static int h264_mp4toannexb_filter(AVBitStreamFilterContext *bsfc,
         unit_type = *buf & 0x1f;
 
         if (buf + nal_size > buf_end || nal_size < 0)
-            goto fail;
+            return AVERROR(EINVAL);
 
         /* prepend only to the first type 5 NAL unit of an IDR picture */
-        if (ctx->first_idr && unit_type == 5) {
-            if (alloc_and_copy(poutbuf, poutbuf_size,
-                               avctx->extradata, avctx->extradata_size,
-                               buf, nal_size) < 0)
-                goto fail;
-            ctx->first_idr = 0;
-        } else {
-            if (alloc_and_copy(poutbuf, poutbuf_size,
-                               NULL, 0, buf, nal_size) < 0)
-                goto fail;
-            if (!ctx->first_idr && unit_type == 1)
-                ctx->first_idr = 1;
+        if (first_idr && unit_type == 5) {
+            sps_pps      = avctx->extradata;
+            sps_pps_size = avctx->extradata_size;
+            first_idr    = 0;
+        } else if (!first_idr && unit_type == 1) {
+            first_idr = 1;
+        }
+
+        if (out) {
+            uint8_t *dst = out + out_size;
+
+            if (sps_pps)
+                memcpy(dst, sps_pps, sps_pps_size);
+            dst += sps_pps_size;
+            if (nal_header_size == 4) {
+                AV_WB32(dst, 1);
+            } else {
+                dst[0] = dst[1] = 0;
+                dst[2] = 1;
+            }
+            memcpy(dst + nal_header_size, buf, nal_size);
         }
 
+        out_size += sps_pps_size + nal_header_size + nal_size;
+        if (out_size > INT_MAX - FF_INPUT_BUFFER_PADDING_SIZE)
+            return AVERROR(EINVAL);
+
         buf        += nal_size;
         cumul_size += nal_size + ctx->length_size;
     } while (cumul_size < buf_size);
 
-    return 1;
+    if (out)
+        ctx->first_idr = first_idr;
+
+    return out_size;
+}
+
+static int h264_mp4toannexb_filter(AVBitStreamFilterContext *bsfc,
+                                   AVCodecContext *avctx, const char *args,
+                                   uint8_t **poutbuf, int *poutbuf_size,
+                                   const uint8_t *buf, int buf_size,
+                                   int keyframe)
+{
+    H264BSFContext *ctx = bsfc->priv_data;
+    uint8_t *out;
+    int ret;
+
+    /* nothing to filter */
+    if (!avctx->extradata || avctx->extradata_size < 6) {
+        *poutbuf      = (uint8_t *)buf;
+        *poutbuf_size = buf_size;
+        return 0;
+    }
+
+    if ((ret = parse_extradata(ctx, avctx)) < 0)
+        return ret;
 
-fail:
-    av_freep(poutbuf);
     *poutbuf_size = 0;
-    return AVERROR(EINVAL);
+    *poutbuf      = NULL;
+
+    ret = convert_packet(ctx, avctx, NULL, buf, buf_size);
+    if (ret < 0)
+        return ret;
+
+    out = av_malloc(ret + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!out)
+        return AVERROR(ENOMEM);
+    convert_packet(ctx, avctx, out, buf, buf_size);
+    memset(out + ret, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+
+    *poutbuf      = out;
+    *poutbuf_size = ret;
+    return 1;
+}
+
+static int h264_mp4toannexb_filter_packet(AVBitStreamFilterContext *bsfc,
+                                          AVCodecContext *avctx,
+                                          const char *args,
+                                          AVPacket *out, const AVPacket *in)
+{
+    H264BSFContext *ctx = bsfc->priv_data;
+    int ret;
+
+    /* nothing to filter */
+    if (!avctx->extradata || avctx->extradata_size < 6)
+        return 0;
+
+    if ((ret = parse_extradata(ctx, avctx)) < 0)
+        return ret;
+
+    ret = convert_packet(ctx, avctx, NULL, in->data, in->size);
+    if (ret < 0)
+        return ret;
+
+    if ((ret = ff_bsf_get_buffer(bsfc, out, ret)) < 0)
+        return ret;
+    convert_packet(ctx, avctx, out->data, in->data, in->size);
+
+    return 1;
 }
 
 AVBitStreamFilter ff_h264_mp4toannexb_bsf = {
-    "h264_mp4toannexb",
-    sizeof(H264BSFContext),
-    h264_mp4toannexb_filter,
+    .name           = "h264_mp4toannexb",
+    .priv_data_size = sizeof(H264BSFContext),
+    .filter         = h264_mp4toannexb_filter,
+    .filter_packet  = h264_mp4toannexb_filter_packet,
 };
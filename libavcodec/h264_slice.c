@@ -220,6 +220,19 @@ static int init_table_pools(H264Context *h)
     const int b4_stride     = h->mb_width * 4 + 1;
     const int b4_array_size = b4_stride * h->mb_height * 4;
 
+    /* Reuse the pools after a resolution change if their buffers are large
+     * enough, unless most of their memory would be wasted. */
+    if (h->qscale_table_pool &&
+        h->mb_width  <= h->pools_mb_width &&
+        h->mb_height <= h->pools_mb_height &&
+        4 * h->mb_width * h->mb_height >= h->pools_mb_width * h->pools_mb_height)
+        return 0;
+
+    av_buffer_pool_uninit(&h->qscale_table_pool);
+    av_buffer_pool_uninit(&h->mb_type_pool);
+    av_buffer_pool_uninit(&h->motion_val_pool);
+    av_buffer_pool_uninit(&h->ref_index_pool);
+
     h->qscale_table_pool = av_buffer_pool_init(big_mb_num + h->mb_stride,
                                                av_buffer_allocz);
     h->mb_type_pool      = av_buffer_pool_init((big_mb_num + h->mb_stride) *
@@ -236,6 +249,8 @@ static int init_table_pools(H264Context *h)
         av_buffer_pool_uninit(&h->ref_index_pool);
         return AVERROR(ENOMEM);
     }
+    h->pools_mb_width  = h->mb_width;
+    h->pools_mb_height = h->mb_height;
 
     return 0;
 }
@@ -266,11 +281,9 @@ static int alloc_picture(H264Context *h, H264Picture *pic)
         }
     }
 
-    if (!h->qscale_table_pool) {
-        ret = init_table_pools(h);
-        if (ret < 0)
-            goto fail;
-    }
+    ret = init_table_pools(h);
+    if (ret < 0)
+        goto fail;
 
     pic->qscale_table_buf = av_buffer_pool_get(h->qscale_table_pool);
     pic->mb_type_buf      = av_buffer_pool_get(h->mb_type_pool);
@@ -544,6 +557,7 @@ int ff_h264_update_thread_context(AVCodecContext *dst,
         h->mb_type_pool      = NULL;
         h->ref_index_pool    = NULL;
         h->motion_val_pool   = NULL;
+        h->deblock_ctx       = NULL;
 
         ret = ff_h264_alloc_tables(h);
         if (ret < 0) {
@@ -1063,8 +1077,10 @@ static int init_dimensions(H264Context *h)
 
 static int h264_slice_header_init(H264Context *h, int reinit)
 {
+    /* Frame threads running slice threads only use them for the loop filter
+     * thread, slice contexts are not duplicated across frame threads. */
     int nb_slices = (HAVE_THREADS &&
-                     h->avctx->active_thread_type & FF_THREAD_SLICE) ?
+                     h->avctx->active_thread_type == FF_THREAD_SLICE) ?
                     h->avctx->thread_count : 1;
     int i, ret;
 
@@ -2097,9 +2113,10 @@ static void loop_filter(H264Context *h, int start_x, int end_x)
                     linesize   = h->mb_linesize   = h->linesize;
                     uvlinesize = h->mb_uvlinesize = h->uvlinesize;
                 }
-                backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize,
-                                 uvlinesize, 0);
-                if (fill_filter_caches(h, mb_type))
+                if (h->deblock_thread != 2)
+                    backup_mb_border(h, dest_y, dest_cb, dest_cr, linesize,
+                                     uvlinesize, 0);
+                if (h->deblock_thread == 1 || fill_filter_caches(h, mb_type))
                     continue;
                 h->chroma_qp[0] = get_chroma_qp(h, 0, h->cur_pic.qscale_table[mb_xy]);
                 h->chroma_qp[1] = get_chroma_qp(h, 1, h->cur_pic.qscale_table[mb_xy]);
@@ -2112,6 +2129,8 @@ static void loop_filter(H264Context *h, int start_x, int end_x)
                                            dest_cr, linesize, uvlinesize);
                 }
             }
+        if (h->deblock_thread == 1)
+            h->deblock_end_x = end_x;
     }
     h->slice_type   = old_slice_type;
     h->mb_x         = end_x;
@@ -2140,6 +2159,13 @@ static void decode_finish_row(H264Context *h)
     int height         =  16      << FRAME_MBAFF(h);
     int deblock_border = (16 + 4) << FRAME_MBAFF(h);
 
+    if (h->deblock_thread == 1) {
+        /* the row is drawn by the deblocking thread once it is filtered */
+        h->deblock_end_x = 0;
+        ff_slice_thread_report_progress(h->avctx, 0, h->mb_y + 1);
+        return;
+    }
+
     if (h->deblocking_filter) {
         if ((top + height) >= pic_height)
             height += deblock_border;
@@ -2336,6 +2362,47 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     }
 }
 
+/**
+ * Decode a slice in the first job while the second one runs the loop filter
+ * one MB row behind it.
+ *
+ * A row can only be filtered once the next one is decoded, since the intra
+ * prediction of the next row temporarily swaps the unfiltered bottom border
+ * of the row back into the picture.
+ */
+static int decode_slice_deblock(AVCodecContext *avctx, void *arg,
+                                int jobnr, int threadnr)
+{
+    H264Context *h  = arg;
+    H264Context *hd = h->deblock_ctx;
+    int progress = 0, mb_y, ret;
+
+    if (!jobnr) {
+        ret = decode_slice(avctx, &h);
+
+        h->deblock_end_y = h->mb_y;
+        ff_slice_thread_report_progress(avctx, 0, INT_MAX);
+        return ret;
+    }
+
+    for (mb_y = hd->mb_y; mb_y < h->mb_height; mb_y++) {
+        if (progress != INT_MAX)
+            progress = ff_slice_thread_await_progress(avctx, 0, mb_y + 2);
+        if (progress == INT_MAX && mb_y >= h->deblock_end_y)
+            break;
+
+        hd->mb_y = mb_y;
+        loop_filter(hd, 0, h->mb_width);
+        decode_finish_row(hd);
+    }
+    if (h->deblock_end_x) {
+        hd->mb_y = h->deblock_end_y;
+        loop_filter(hd, 0, h->deblock_end_x);
+    }
+
+    return 0;
+}
+
 /**
  * Call decode_slice() for each context.
  *
@@ -2357,6 +2424,29 @@ int ff_h264_execute_decode_slices(H264Context *h, unsigned context_count)
     if (h->avctx->hwaccel)
         return 0;
     if (context_count == 1) {
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_SLICE) &&
+            avctx->thread_count > 1 && h->deblocking_filter && !h->mb_x &&
+            h->picture_structure == PICT_FRAME && !FRAME_MBAFF(h)) {
+            int ret[2];
+
+            if (!h->deblock_ctx) {
+                h->deblock_ctx = av_malloc(sizeof(*h->deblock_ctx));
+                if (!h->deblock_ctx)
+                    return AVERROR(ENOMEM);
+            }
+            if ((ret[0] = ff_slice_thread_init_progress(avctx, 1)) < 0)
+                return ret[0];
+
+            h->deblock_end_x = 0;
+            memcpy(h->deblock_ctx, h, sizeof(*h));
+            h->deblock_ctx->deblock_thread = 2;
+            h->deblock_thread              = 1;
+
+            avctx->execute2(avctx, decode_slice_deblock, h, ret, 2);
+
+            h->deblock_thread = 0;
+            return ret[0];
+        }
         return decode_slice(avctx, &h);
     } else {
         for (i = 1; i < context_count; i++) {
@@ -160,7 +160,7 @@ static const uint8_t diag_scan8x8_inv[8][8] = {
  * Section 5.7
  */
 
-/* free everything allocated  by pic_arrays_init() */
+/* free the arrays allocated by pic_arrays_init(), the frame pools are kept */
 static void pic_arrays_free(HEVCContext *s)
 {
     av_freep(&s->sao);
@@ -180,11 +180,44 @@ static void pic_arrays_free(HEVCContext *s)
 
     av_freep(&s->horizontal_bs);
     av_freep(&s->vertical_bs);
+}
 
+static void pic_pools_free(HEVCContext *s)
+{
     av_buffer_pool_uninit(&s->tab_mvf_pool);
     av_buffer_pool_uninit(&s->rpl_tab_pool);
 }
 
+/* allocate the per-frame buffer pools, they are kept across SPS changes as
+ * long as their buffers are large enough, unless most of their memory would
+ * be wasted */
+static int pic_pools_init(HEVCContext *s, const HEVCSPS *sps)
+{
+    int ctb_count   = sps->ctb_width * sps->ctb_height;
+    int min_pu_size = sps->min_pu_width * sps->min_pu_height;
+
+    if (s->tab_mvf_pool &&
+        min_pu_size <= s->pools_min_pu_size &&
+        ctb_count   <= s->pools_ctb_count   &&
+        4 * min_pu_size >= s->pools_min_pu_size)
+        return 0;
+
+    pic_pools_free(s);
+
+    s->tab_mvf_pool = av_buffer_pool_init(min_pu_size * sizeof(MvField),
+                                          av_buffer_alloc);
+    s->rpl_tab_pool = av_buffer_pool_init(ctb_count * sizeof(RefPicListTab),
+                                          av_buffer_allocz);
+    if (!s->tab_mvf_pool || !s->rpl_tab_pool) {
+        pic_pools_free(s);
+        return AVERROR(ENOMEM);
+    }
+    s->pools_min_pu_size = min_pu_size;
+    s->pools_ctb_count   = ctb_count;
+
+    return 0;
+}
+
 /* allocate arrays that depend on frame dimensions */
 static int pic_arrays_init(HEVCContext *s, const HEVCSPS *sps)
 {
@@ -230,11 +263,7 @@ static int pic_arrays_init(HEVCContext *s, const HEVCSPS *sps)
     if (!s->horizontal_bs || !s->vertical_bs)
         goto fail;
 
-    s->tab_mvf_pool = av_buffer_pool_init(min_pu_size * sizeof(MvField),
-                                          av_buffer_alloc);
-    s->rpl_tab_pool = av_buffer_pool_init(ctb_count * sizeof(RefPicListTab),
-                                          av_buffer_allocz);
-    if (!s->tab_mvf_pool || !s->rpl_tab_pool)
+    if (pic_pools_init(s, sps) < 0)
         goto fail;
 
     return 0;
@@ -2989,6 +3018,7 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
     int i;
 
     pic_arrays_free(s);
+    pic_pools_free(s);
 
     av_freep(&s->md5_ctx);
 
@@ -782,6 +782,8 @@ typedef struct HEVCContext {
 
     AVBufferPool *tab_mvf_pool;
     AVBufferPool *rpl_tab_pool;
+    int pools_min_pu_size;  ///< number of min PUs the pool buffers are sized for
+    int pools_ctb_count;    ///< number of CTBs the pool buffers are sized for
 
     ///< candidate references for the current frame
     RefPicList rps[5];
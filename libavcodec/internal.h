@@ -35,6 +35,19 @@
 
 #define FF_SANE_NB_CHANNELS 63U
 
+/**
+ * The decoder supports slice threading in each of its frame threads,
+ * i.e. it handles active_thread_type == FF_THREAD_FRAME | FF_THREAD_SLICE.
+ * It runs at most FF_FRAME_SLICE_JOBS slice jobs at once in that mode.
+ */
+#define FF_CODEC_CAP_FRAME_SLICE_THREADS (1 << 0)
+
+/**
+ * Number of slice threads started per frame thread for decoders with
+ * FF_CODEC_CAP_FRAME_SLICE_THREADS, more would never get a job.
+ */
+#define FF_FRAME_SLICE_JOBS 2
+
 typedef struct FramePool {
     /**
      * Pools for each data plane. For audio all the planes have the same size,
@@ -49,6 +62,7 @@ typedef struct FramePool {
     int width, height;
     int stride_align[AV_NUM_DATA_POINTERS];
     int linesize[4];
+    int buf_size[4];    ///< size of the video buffers in each pool
     int planes;
     int channels;
     int samples;
@@ -90,6 +104,12 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threading context, kept apart from thread_ctx so that frame
+     * thread copies can run their own slice threads.
+     */
+    void *slice_thread_ctx;
+
     /**
      * Current packet as passed into the decoder, to avoid having to pass the
      * packet into every function.
@@ -191,4 +211,13 @@ int ff_side_data_update_matrix_encoding(AVFrame *frame,
  */
 int ff_decode_frame_props(AVCodecContext *avctx, AVFrame *frame);
 
+/**
+ * Get a buffer for the output of a bitstream filter from the pools of bsfc
+ * and set it as the data of pkt, with the padding zeroed. The buffer is
+ * less than twice the size of the data.
+ *
+ * @param size size of the data, without padding
+ */
+int ff_bsf_get_buffer(AVBitStreamFilterContext *bsfc, AVPacket *pkt, int size);
+
 #endif /* AVCODEC_INTERNAL_H */
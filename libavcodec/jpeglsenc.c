@@ -429,6 +429,7 @@ AVCodec ff_jpegls_encoder = {
     .init           = encode_init_ls,
     .close          = encode_close,
     .encode2        = encode_picture_ls,
+    .capabilities   = CODEC_CAP_FRAME_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_BGR24, AV_PIX_FMT_RGB24,
         AV_PIX_FMT_GRAY8, AV_PIX_FMT_GRAY16,
@@ -850,6 +850,18 @@ static inline int get_penalty_factor(int lambda, int lambda2, int type){
     }
 }
 
+void ff_reset_me_state(MpegEncContext *s)
+{
+    MotionEstContext * const c = &s->me;
+
+    c->penalty_factor     = get_penalty_factor(s->lambda, s->lambda2, c->avctx->me_cmp);
+    c->sub_penalty_factor = get_penalty_factor(s->lambda, s->lambda2, c->avctx->me_sub_cmp);
+    c->mb_penalty_factor  = get_penalty_factor(s->lambda, s->lambda2, c->avctx->mb_cmp);
+    c->pre_penalty_factor = get_penalty_factor(s->lambda, s->lambda2, c->avctx->me_pre_cmp);
+    c->pred_x = 0;
+    c->pred_y = 0;
+}
+
 void ff_estimate_p_frame_motion(MpegEncContext * s,
                                 int mb_x, int mb_y)
 {
@@ -25,6 +25,8 @@
  * MPEG-1/2 decoder
  */
 
+#define CACHED_BITSTREAM_READER
+
 #include <inttypes.h>
 
 #include "libavutil/attributes.h"
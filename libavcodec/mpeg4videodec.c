@@ -20,6 +20,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define CACHED_BITSTREAM_READER
+
 #include "error_resilience.h"
 #include "internal.h"
 #include "mpegutils.h"
@@ -1025,6 +1027,7 @@ static inline int mpeg4_decode_block(Mpeg4DecContext *ctx, int16_t *block,
                     last = SHOW_UBITS(re, &s->gb, 1);
                     SKIP_CACHE(re, &s->gb, 1);
                     run = SHOW_UBITS(re, &s->gb, 6);
+                    SKIP_CACHE(re, &s->gb, 6);
                     SKIP_COUNTER(re, &s->gb, 1 + 1 + 6);
                     UPDATE_CACHE(re, &s->gb);
 
@@ -1046,6 +1049,7 @@ static inline int mpeg4_decode_block(Mpeg4DecContext *ctx, int16_t *block,
 
                     level = level * qmul + qadd;
                     level = (level ^ SHOW_SBITS(re, &s->gb, 1)) - SHOW_SBITS(re, &s->gb, 1);
+                    SKIP_CACHE(re, &s->gb, 1);
                     SKIP_COUNTER(re, &s->gb, 1 + 11 + 5 + 1);
 
                     i += run + 1;
@@ -1065,6 +1069,7 @@ static inline int mpeg4_decode_block(Mpeg4DecContext *ctx, int16_t *block,
                             last = SHOW_UBITS(re, &s->gb, 1);
                             SKIP_CACHE(re, &s->gb, 1);
                             run = SHOW_UBITS(re, &s->gb, 6);
+                            SKIP_CACHE(re, &s->gb, 6);
                             SKIP_COUNTER(re, &s->gb, 2 + 1 + 6);
                             UPDATE_CACHE(re, &s->gb);
 
@@ -1087,6 +1092,7 @@ static inline int mpeg4_decode_block(Mpeg4DecContext *ctx, int16_t *block,
                                            "2. marker bit missing in 3. esc\n");
                                     return -1;
                                 }
+                                SKIP_CACHE(re, &s->gb, 1);
 
                                 SKIP_COUNTER(re, &s->gb, 1 + 12 + 1);
                             }
@@ -20,17 +20,26 @@
 
 #include "config.h"
 #include "libavutil/attributes.h"
+#include "libavutil/thread.h"
 #include "mpegaudiodsp.h"
 #include "dct.h"
 #include "dct32.h"
 
+static av_cold void mpadsp_init_static(void)
+{
+    ff_init_mpadsp_tabs_float();
+    ff_init_mpadsp_tabs_fixed();
+}
+
 av_cold void ff_mpadsp_init(MPADSPContext *s)
 {
+    static AVOnce init_static_once = AV_ONCE_INIT;
     DCTContext dct;
 
     ff_dct_init(&dct, 5, DCT_II);
-    ff_init_mpadsp_tabs_float();
-    ff_init_mpadsp_tabs_fixed();
+
+    /* the tables are shared by all instances */
+    ff_thread_once(&init_static_once, mpadsp_init_static);
 
     s->apply_window_float = ff_mpadsp_apply_window_float;
     s->apply_window_fixed = ff_mpadsp_apply_window_fixed;
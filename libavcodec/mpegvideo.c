@@ -724,6 +724,8 @@ int ff_mpeg_ref_picture(MpegEncContext *s, Picture *dst, Picture *src)
     dst->mb_var_sum              = src->mb_var_sum;
     dst->mc_mb_var_sum           = src->mc_mb_var_sum;
     dst->b_frame_score           = src->b_frame_score;
+    dst->lookahead_intra         = src->lookahead_intra;
+    dst->lookahead_cut           = src->lookahead_cut;
     dst->needs_realloc           = src->needs_realloc;
     dst->reference               = src->reference;
     dst->shared                  = src->shared;
@@ -1005,6 +1007,7 @@ void ff_MPV_common_defaults(MpegEncContext *s)
     s->b_code                = 1;
 
     s->slice_context_count   = 1;
+    s->thread_context_count  = 1;
 }
 
 /**
@@ -1194,6 +1197,46 @@ fail:
     return AVERROR(ENOMEM);
 }
 
+/**
+ * Allocate the thread contexts, the first nb_slices of them being assigned
+ * a slice of macroblock rows.
+ */
+static int init_thread_contexts(MpegEncContext *s, int nb_slices,
+                                int nb_contexts)
+{
+    int i;
+
+    if (nb_contexts > 1) {
+        for (i = 1; i < nb_contexts; i++) {
+            s->thread_context[i] = av_malloc(sizeof(MpegEncContext));
+            if (!s->thread_context[i])
+                return AVERROR(ENOMEM);
+            memcpy(s->thread_context[i], s, sizeof(MpegEncContext));
+            s->thread_context_count = i + 1;
+        }
+
+        for (i = 0; i < nb_contexts; i++) {
+            if (init_duplicate_context(s->thread_context[i]) < 0)
+                return AVERROR(ENOMEM);
+            if (i < nb_slices) {
+                s->thread_context[i]->start_mb_y =
+                    (s->mb_height * (i) + nb_slices / 2) / nb_slices;
+                s->thread_context[i]->end_mb_y   =
+                    (s->mb_height * (i + 1) + nb_slices / 2) / nb_slices;
+            }
+        }
+    } else {
+        if (init_duplicate_context(s) < 0)
+            return AVERROR(ENOMEM);
+        s->start_mb_y = 0;
+        s->end_mb_y   = s->mb_height;
+    }
+    s->slice_context_count  = nb_slices;
+    s->thread_context_count = nb_contexts;
+
+    return 0;
+}
+
 /**
  * init common structure for both encoder and decoder.
  * this assumes that some variables like width/height are already set
@@ -1204,6 +1247,7 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
     int nb_slices = (HAVE_THREADS &&
                      s->avctx->active_thread_type & FF_THREAD_SLICE) ?
                     s->avctx->thread_count : 1;
+    int nb_contexts = nb_slices;
 
     if (s->encoding && s->avctx->slices)
         nb_slices = s->avctx->slices;
@@ -1229,6 +1273,7 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
                " reducing to %d\n", nb_slices, max_slices);
         nb_slices = max_slices;
     }
+    nb_contexts = FFMIN(FFMAX(nb_contexts, nb_slices), MAX_THREADS);
 
     if ((s->width || s->height) &&
         av_image_check_size(s->width, s->height, 0, s->avctx))
@@ -1284,27 +1329,10 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
     s->thread_context[0]   = s;
 
     if (s->width && s->height) {
-        if (nb_slices > 1) {
-            for (i = 1; i < nb_slices; i++) {
-                s->thread_context[i] = av_malloc(sizeof(MpegEncContext));
-                memcpy(s->thread_context[i], s, sizeof(MpegEncContext));
-            }
-
-            for (i = 0; i < nb_slices; i++) {
-                if (init_duplicate_context(s->thread_context[i]) < 0)
-                    goto fail;
-                    s->thread_context[i]->start_mb_y =
-                        (s->mb_height * (i) + nb_slices / 2) / nb_slices;
-                    s->thread_context[i]->end_mb_y   =
-                        (s->mb_height * (i + 1) + nb_slices / 2) / nb_slices;
-            }
-        } else {
-            if (init_duplicate_context(s) < 0)
-                goto fail;
-            s->start_mb_y = 0;
-            s->end_mb_y   = s->mb_height;
-        }
-        s->slice_context_count = nb_slices;
+        if (!s->encoding)
+            nb_contexts = nb_slices;
+        if (init_thread_contexts(s, nb_slices, nb_contexts) < 0)
+            goto fail;
     }
 
     return 0;
@@ -1372,11 +1400,11 @@ int ff_MPV_common_frame_size_change(MpegEncContext *s)
 {
     int i, err = 0;
 
-    if (s->slice_context_count > 1) {
-        for (i = 0; i < s->slice_context_count; i++) {
+    if (s->thread_context_count > 1) {
+        for (i = 0; i < s->thread_context_count; i++) {
             free_duplicate_context(s->thread_context[i]);
         }
-        for (i = 1; i < s->slice_context_count; i++) {
+        for (i = 1; i < s->thread_context_count; i++) {
             av_freep(&s->thread_context[i]);
         }
     } else
@@ -1410,28 +1438,9 @@ int ff_MPV_common_frame_size_change(MpegEncContext *s)
     s->thread_context[0]   = s;
 
     if (s->width && s->height) {
-        int nb_slices = s->slice_context_count;
-        if (nb_slices > 1) {
-            for (i = 1; i < nb_slices; i++) {
-                s->thread_context[i] = av_malloc(sizeof(MpegEncContext));
-                memcpy(s->thread_context[i], s, sizeof(MpegEncContext));
-            }
-
-            for (i = 0; i < nb_slices; i++) {
-                if (init_duplicate_context(s->thread_context[i]) < 0)
-                    goto fail;
-                    s->thread_context[i]->start_mb_y =
-                        (s->mb_height * (i) + nb_slices / 2) / nb_slices;
-                    s->thread_context[i]->end_mb_y   =
-                        (s->mb_height * (i + 1) + nb_slices / 2) / nb_slices;
-            }
-        } else {
-            if (init_duplicate_context(s) < 0)
-                goto fail;
-            s->start_mb_y = 0;
-            s->end_mb_y   = s->mb_height;
-        }
-        s->slice_context_count = nb_slices;
+        if ((err = init_thread_contexts(s, s->slice_context_count,
+                                        s->thread_context_count)) < 0)
+            goto fail;
     }
 
     return 0;
@@ -1445,14 +1454,15 @@ void ff_MPV_common_end(MpegEncContext *s)
 {
     int i;
 
-    if (s->slice_context_count > 1) {
-        for (i = 0; i < s->slice_context_count; i++) {
+    if (s->thread_context_count > 1) {
+        for (i = 0; i < s->thread_context_count; i++) {
             free_duplicate_context(s->thread_context[i]);
         }
-        for (i = 1; i < s->slice_context_count; i++) {
+        for (i = 1; i < s->thread_context_count; i++) {
             av_freep(&s->thread_context[i]);
         }
-        s->slice_context_count = 1;
+        s->slice_context_count  = 1;
+        s->thread_context_count = 1;
     } else free_duplicate_context(s);
 
     av_freep(&s->parse_context.buffer);
@@ -130,6 +130,8 @@ typedef struct Picture{
     int mc_mb_var_sum;          ///< motion compensated MB variance for current frame
 
     int b_frame_score;          /* */
+    int lookahead_intra;        ///< lookahead intra count against the previous input picture + 1, 0 if not analysed
+    int lookahead_cut;          ///< lookahead scene cut candidate, confirmed against the following pictures
     int needs_realloc;          ///< Picture needs to be reallocated (eg due to a frame size change)
 
     int reference;
@@ -274,6 +276,7 @@ typedef struct MpegEncContext {
     int end_mb_y;              ///< end   mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
     struct MpegEncContext *thread_context[MAX_THREADS];
     int slice_context_count;   ///< number of used thread_contexts
+    int thread_context_count;  ///< number of allocated thread_contexts, encoders allocate one per thread for motion estimation
 
     /**
      * copy of the previous picture structure.
@@ -624,6 +627,9 @@ typedef struct MpegEncContext {
     int mpv_flags;      ///< flags set by private options
     int quantizer_noise_shaping;
 
+    int lookahead;      ///< number of input pictures analysed ahead of the frame type decision
+    int *lookahead_rows; ///< per macroblock row intra count of the picture being analysed
+
     /* temp buffers for rate control */
     float *cplx_tab, *bits_tab;
 
@@ -664,7 +670,9 @@ typedef struct MpegEncContext {
                                                                       FF_MPV_OFFSET(chroma_elim_threshold), AV_OPT_TYPE_INT, { .i64 = 0 }, INT_MIN, INT_MAX, FF_MPV_OPT_FLAGS },\
 { "quantizer_noise_shaping", NULL,                                  FF_MPV_OFFSET(quantizer_noise_shaping), AV_OPT_TYPE_INT, { .i64 = 0 },       0, INT_MAX, FF_MPV_OPT_FLAGS },\
 { "error_rate", "Simulate errors in the bitstream to test error concealment.",                                                                                                  \
-                                                                    FF_MPV_OFFSET(error_rate),              AV_OPT_TYPE_INT, { .i64 = 0 },       0, INT_MAX, FF_MPV_OPT_FLAGS },
+                                                                    FF_MPV_OFFSET(error_rate),              AV_OPT_TYPE_INT, { .i64 = 0 },       0, INT_MAX, FF_MPV_OPT_FLAGS },\
+{ "lookahead", "Number of frames analysed ahead for scene cut and B-frame decisions",                                                                                           \
+                                                                    FF_MPV_OFFSET(lookahead),               AV_OPT_TYPE_INT, { .i64 = 0 },       0, MAX_B_FRAMES, FF_MPV_OPT_FLAGS },
 
 extern const AVOption ff_mpv_generic_options[];
 
@@ -782,6 +790,12 @@ void ff_fix_long_p_mvs(MpegEncContext * s);
 void ff_fix_long_mvs(MpegEncContext * s, uint8_t *field_select_table, int field_select,
                      int16_t (*mv_table)[2], int f_code, int type, int truncate);
 int ff_init_me(MpegEncContext *s);
+/**
+ * Reset the state the motion estimation carries from one macroblock to the
+ * next, so that it does not depend on the macroblocks previously estimated
+ * with the same context.
+ */
+void ff_reset_me_state(MpegEncContext *s);
 int ff_pre_estimate_p_frame_motion(MpegEncContext * s, int mb_x, int mb_y);
 int ff_epzs_motion_search(MpegEncContext * s, int *mx_ptr, int *my_ptr,
                              int P[10][2], int src_index, int ref_index, int16_t (*last_mv)[2],
@@ -400,6 +400,18 @@ av_cold int ff_MPV_encode_init(AVCodecContext *avctx)
         return -1;
     }
 
+    if (s->lookahead) {
+        if (!(avctx->codec->capabilities & CODEC_CAP_DELAY)) {
+            av_log(avctx, AV_LOG_ERROR, "lookahead not supported by codec\n");
+            return -1;
+        }
+        if (s->max_b_frames + s->lookahead > MAX_B_FRAMES) {
+            av_log(avctx, AV_LOG_ERROR, "Too many B-frames and lookahead "
+                   "frames requested, maximum is %d.\n", MAX_B_FRAMES);
+            return -1;
+        }
+    }
+
     if ((s->codec_id == AV_CODEC_ID_MPEG4 ||
          s->codec_id == AV_CODEC_ID_H263  ||
          s->codec_id == AV_CODEC_ID_H263P) &&
@@ -671,6 +683,7 @@ av_cold int ff_MPV_encode_init(AVCodecContext *avctx)
         return -1;
     }
 
+    avctx->delay       += s->lookahead;
     avctx->has_b_frames = !s->low_delay;
 
     s->encoding = 1;
@@ -695,6 +708,9 @@ av_cold int ff_MPV_encode_init(AVCodecContext *avctx)
                           (MAX_RUN + 1) * 2 * sizeof(int), fail);
     }
     FF_ALLOCZ_OR_GOTO(s->avctx, s->avctx->stats_out, 256, fail);
+    if (s->lookahead)
+        FF_ALLOCZ_OR_GOTO(s->avctx, s->lookahead_rows,
+                          s->mb_height * sizeof(int), fail);
 
     FF_ALLOCZ_OR_GOTO(s->avctx, s->q_intra_matrix,   64 * 32 * sizeof(int), fail);
     FF_ALLOCZ_OR_GOTO(s->avctx, s->q_inter_matrix,   64 * 32 * sizeof(int), fail);
@@ -824,6 +840,7 @@ av_cold int ff_MPV_encode_end(AVCodecContext *avctx)
 
     av_freep(&s->avctx->stats_out);
     av_freep(&s->ac_stats);
+    av_freep(&s->lookahead_rows);
 
     av_freep(&s->q_intra_matrix);
     av_freep(&s->q_inter_matrix);
@@ -850,27 +867,112 @@ static int get_sae(uint8_t *src, int ref, int stride)
     return acc;
 }
 
+static int get_intra_count_row(MpegEncContext *s, uint8_t *src,
+                               uint8_t *ref, int stride)
+{
+    int x, w;
+    int acc = 0;
+
+    w = s->width & ~15;
+
+    for (x = 0; x < w; x += 16) {
+        int sad  = s->dsp.sad[0](NULL, src + x, ref + x, stride, 16);
+        int mean = (s->dsp.pix_sum(src + x, stride) + 128) >> 8;
+        int sae  = get_sae(src + x, mean, stride);
+
+        acc += sae + 500 < sad;
+    }
+    return acc;
+}
+
 static int get_intra_count(MpegEncContext *s, uint8_t *src,
                            uint8_t *ref, int stride)
 {
-    int x, y, w, h;
+    int y, h;
     int acc = 0;
 
-    w = s->width  & ~15;
     h = s->height & ~15;
 
-    for (y = 0; y < h; y += 16) {
-        for (x = 0; x < w; x += 16) {
-            int offset = x + y * stride;
-            int sad  = s->dsp.sad[0](NULL, src + offset, ref + offset, stride,
-                                     16);
-            int mean = (s->dsp.pix_sum(src + offset, stride) + 128) >> 8;
-            int sae  = get_sae(src + offset, mean, stride);
+    for (y = 0; y < h; y += 16)
+        acc += get_intra_count_row(s, src + y * stride, ref + y * stride,
+                                   stride);
+    return acc;
+}
+
+static int intra_count_row_thread(AVCodecContext *c, void *arg,
+                                  int jobnr, int threadnr)
+{
+    MpegEncContext *s = c->priv_data;
+    Picture **pic     = arg;
+    int offset        = 16 * jobnr * s->linesize;
+
+    s->lookahead_rows[jobnr] = get_intra_count_row(s,
+                                                   pic[0]->f->data[0] + offset,
+                                                   pic[1]->f->data[0] + offset,
+                                                   s->linesize);
+    return 0;
+}
+
+/**
+ * Analyse a picture entering the lookahead against the previous input
+ * picture. The rows are split between the slice threads.
+ *
+ * The intra count is also used as the B-frame score of b_frame_strategy 1.
+ * A picture where most macroblocks are better coded as intra, and at least
+ * twice as many as in the previous picture, is a scene cut candidate.
+ */
+static void lookahead_analyse(MpegEncContext *s, Picture *pic, Picture *prev)
+{
+    Picture *pics[2] = { pic, prev };
+    int rows         = s->height >> 4;
+    int intra_count  = 0;
+    int i;
+
+    s->avctx->execute2(s->avctx, intra_count_row_thread, pics, NULL, rows);
+    emms_c();
+
+    for (i = 0; i < rows; i++)
+        intra_count += s->lookahead_rows[i];
+    pic->b_frame_score   = intra_count + 1;
+    pic->lookahead_intra = intra_count + 1;
+    pic->lookahead_cut   = intra_count > s->mb_num / 2 &&
+                           intra_count > 2 * FFMAX(prev->lookahead_intra - 1, 0);
+}
+
+/**
+ * Code the scene cut candidates among the pictures whose type is about to
+ * be decided as I pictures. A candidate is only a cut if the queued
+ * pictures following it predict well from it; a flash or a run of fast
+ * motion keeps a high intra count and is left to the normal decision.
+ */
+static void lookahead_scene_cuts(MpegEncContext *s)
+{
+    int i, j;
+
+    if (s->avctx->scenechange_threshold >= 1000000000)
+        return;
+
+    for (i = 0; i <= s->max_b_frames && s->input_picture[i]; i++) {
+        Picture *pic = s->input_picture[i];
+        int cut      = pic->lookahead_cut;
 
-            acc += sae + 500 < sad;
+        if (!cut || pic->f->pict_type)
+            continue;
+
+        for (j = i + 1; j <= i + s->lookahead && j < MAX_PICTURE_COUNT &&
+                        s->input_picture[j]; j++) {
+            if (2 * s->input_picture[j]->lookahead_intra > pic->lookahead_intra) {
+                cut = 0;
+                break;
+            }
+        }
+
+        if (cut) {
+            av_log(s->avctx, AV_LOG_DEBUG, "scene cut at picture %d\n",
+                   pic->f->display_picture_number);
+            pic->f->pict_type = AV_PICTURE_TYPE_I;
         }
     }
-    return acc;
 }
 
 
@@ -879,8 +981,9 @@ static int load_input_picture(MpegEncContext *s, const AVFrame *pic_arg)
     Picture *pic = NULL;
     int64_t pts;
     int i, display_picture_number = 0, ret;
-    const int encoding_delay = s->max_b_frames ? s->max_b_frames :
-                                                 (s->low_delay ? 0 : 1);
+    const int encoding_delay = (s->max_b_frames ? s->max_b_frames :
+                                                  (s->low_delay ? 0 : 1)) +
+                               s->lookahead;
     int direct = 1;
 
     if (pic_arg) {
@@ -1003,6 +1106,12 @@ static int load_input_picture(MpegEncContext *s, const AVFrame *pic_arg)
 
     s->input_picture[encoding_delay] = (Picture*) pic;
 
+    if (pic && s->lookahead) {
+        Picture *prev = s->input_picture[encoding_delay - 1];
+        if (prev && prev->f->data[0])
+            lookahead_analyse(s, pic, prev);
+    }
+
     return 0;
 }
 
@@ -1215,6 +1324,9 @@ static int select_input_picture(MpegEncContext *s)
                 }
             }
 
+            if (s->lookahead)
+                lookahead_scene_cuts(s);
+
             if (s->avctx->b_frame_strategy == 0) {
                 b_frames = s->max_b_frames;
                 while (b_frames && !s->input_picture[b_frames])
@@ -2380,6 +2492,123 @@ static int estimate_motion_thread(AVCodecContext *c, void *arg){
     return 0;
 }
 
+/**
+ * Find the rows of the output slice containing a macroblock row.
+ * The slice contexts are not used, as their rows are overwritten while
+ * they estimate motion.
+ */
+static void get_row_slice(MpegEncContext *s, int mb_y, int *start_mb_y,
+                          int *end_mb_y)
+{
+    int nb_slices = s->slice_context_count;
+    int i = 0;
+
+    do {
+        *start_mb_y = (s->mb_height *  i      + nb_slices / 2) / nb_slices;
+        *end_mb_y   = (s->mb_height * (i + 1) + nb_slices / 2) / nb_slices;
+    } while (mb_y >= *end_mb_y && ++i < nb_slices);
+}
+
+/*
+ * Motion estimation by macroblock rows, independently of the output slices.
+ *
+ * The spatial predictors of a macroblock come from its left, top and
+ * top-right neighbours, so the rows are processed as a wavefront, each row
+ * staying two macroblocks behind the previous one. The slice boundaries and
+ * the order in which the slice threads would process the rows are kept, and
+ * the state carried between macroblocks is reset at the start of each row,
+ * so the result does not depend on the number of threads.
+ */
+static int pre_estimate_motion_row_thread(AVCodecContext *c, void *arg,
+                                          int jobnr, int threadnr)
+{
+    MpegEncContext *s = c->priv_data;
+    MpegEncContext *t = s->thread_context[threadnr];
+    int start_mb_y = t->start_mb_y;
+    int end_mb_y   = t->end_mb_y;
+    int i;
+
+    /* the rows of each slice are processed from the bottom */
+    get_row_slice(s, jobnr, &t->start_mb_y, &t->end_mb_y);
+    t->mb_y             = t->start_mb_y + t->end_mb_y - 1 - jobnr;
+    t->first_slice_line = t->mb_y == t->end_mb_y - 1;
+    t->me.pre_pass      = 1;
+    t->me.dia_size      = c->pre_dia_size;
+    ff_reset_me_state(t);
+
+    /* the top row of a slice uses the bottom row of the previous slice */
+    if (t->mb_y == t->start_mb_y && t->start_mb_y > 0) {
+        int prev_start, prev_end;
+        get_row_slice(s, t->mb_y - 1, &prev_start, &prev_end);
+        ff_slice_thread_await_progress(c, prev_start, s->mb_width);
+    }
+
+    for (i = 0; i < s->mb_width; i++) {
+        if (!t->first_slice_line)
+            ff_slice_thread_await_progress(c, jobnr - 1, FFMIN(i + 2, s->mb_width));
+        t->mb_x = s->mb_width - 1 - i;
+        ff_pre_estimate_p_frame_motion(t, t->mb_x, t->mb_y);
+        ff_slice_thread_report_progress(c, jobnr, i + 1);
+    }
+
+    t->me.pre_pass = 0;
+    t->start_mb_y  = start_mb_y;
+    t->end_mb_y    = end_mb_y;
+
+    return 0;
+}
+
+static int estimate_motion_row_thread(AVCodecContext *c, void *arg,
+                                      int jobnr, int threadnr)
+{
+    MpegEncContext *s = c->priv_data;
+    MpegEncContext *t = s->thread_context[threadnr];
+    int start_mb_y = t->start_mb_y;
+    int end_mb_y   = t->end_mb_y;
+
+    get_row_slice(s, jobnr, &t->start_mb_y, &t->end_mb_y);
+    t->mb_y             = jobnr;
+    t->first_slice_line = jobnr == t->start_mb_y;
+    t->me.dia_size      = c->dia_size;
+    ff_reset_me_state(t);
+
+    t->mb_x = 0;
+    ff_init_block_index(t);
+    for (t->mb_x = 0; t->mb_x < s->mb_width; t->mb_x++) {
+        if (!t->first_slice_line)
+            ff_slice_thread_await_progress(c, jobnr - 1,
+                                           FFMIN(t->mb_x + 2, s->mb_width));
+        t->block_index[0] += 2;
+        t->block_index[1] += 2;
+        t->block_index[2] += 2;
+        t->block_index[3] += 2;
+
+        if (t->pict_type == AV_PICTURE_TYPE_B)
+            ff_estimate_b_frame_motion(t, t->mb_x, t->mb_y);
+        else
+            ff_estimate_p_frame_motion(t, t->mb_x, t->mb_y);
+        ff_slice_thread_report_progress(c, jobnr, t->mb_x + 1);
+    }
+
+    t->start_mb_y = start_mb_y;
+    t->end_mb_y   = end_mb_y;
+
+    return 0;
+}
+
+/**
+ * Check whether motion estimation can be run by macroblock rows, using
+ * every thread even when there are fewer slices.
+ */
+static int use_row_motion_estimation(MpegEncContext *s)
+{
+    /* the last frame predictors may come from rows being estimated */
+    return s->avctx->active_thread_type & FF_THREAD_SLICE &&
+           s->avctx->thread_count > 1 &&
+           s->thread_context_count >= s->avctx->thread_count &&
+           !s->avctx->last_predictor_count;
+}
+
 static int mb_var_thread(AVCodecContext *c, void *arg){
     MpegEncContext *s= *(void**)arg;
     int mb_x, mb_y;
@@ -3224,26 +3453,47 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     }
 
     s->mb_intra=0; //for the rate distortion & bit compare functions
-    for(i=1; i<context_count; i++){
+    /* before the contexts are duplicated, so that they all use the rounding
+     * of the current picture */
+    if(ff_init_me(s)<0)
+        return -1;
+
+    /* also before the contexts are duplicated, so that motion estimation
+     * uses the same lambda in all of them */
+    if(s->pict_type != AV_PICTURE_TYPE_I){
+        s->lambda = (s->lambda * s->avctx->me_penalty_compensation + 128)>>8;
+        s->lambda2= (s->lambda2* (int64_t)s->avctx->me_penalty_compensation + 128)>>8;
+    }
+
+    for(i=1; i<s->thread_context_count; i++){
         ret = ff_update_duplicate_context(s->thread_context[i], s);
         if (ret < 0)
             return ret;
     }
 
-    if(ff_init_me(s)<0)
-        return -1;
-
     /* Estimate motion for every MB */
     if(s->pict_type != AV_PICTURE_TYPE_I){
-        s->lambda = (s->lambda * s->avctx->me_penalty_compensation + 128)>>8;
-        s->lambda2= (s->lambda2* (int64_t)s->avctx->me_penalty_compensation + 128)>>8;
-        if (s->pict_type != AV_PICTURE_TYPE_B) {
-            if((s->avctx->pre_me && s->last_non_b_pict_type==AV_PICTURE_TYPE_I) || s->avctx->pre_me==2){
-                s->avctx->execute(s->avctx, pre_estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+        if (use_row_motion_estimation(s)) {
+            if (s->pict_type != AV_PICTURE_TYPE_B) {
+                if((s->avctx->pre_me && s->last_non_b_pict_type==AV_PICTURE_TYPE_I) || s->avctx->pre_me==2){
+                    if ((ret = ff_slice_thread_init_progress(s->avctx, s->mb_height)) < 0)
+                        return ret;
+                    s->avctx->execute2(s->avctx, pre_estimate_motion_row_thread, NULL, NULL, s->mb_height);
+                }
             }
-        }
 
-        s->avctx->execute(s->avctx, estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+            if ((ret = ff_slice_thread_init_progress(s->avctx, s->mb_height)) < 0)
+                return ret;
+            s->avctx->execute2(s->avctx, estimate_motion_row_thread, NULL, NULL, s->mb_height);
+        } else {
+            if (s->pict_type != AV_PICTURE_TYPE_B) {
+                if((s->avctx->pre_me && s->last_non_b_pict_type==AV_PICTURE_TYPE_I) || s->avctx->pre_me==2){
+                    s->avctx->execute(s->avctx, pre_estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+                }
+            }
+
+            s->avctx->execute(s->avctx, estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+        }
     }else /* if(s->pict_type == AV_PICTURE_TYPE_I) */{
         /* I-Frame */
         for(i=0; i<s->mb_stride*s->mb_height; i++)
@@ -3254,7 +3504,7 @@ static int encode_picture(MpegEncContext *s, int picture_number)
             s->avctx->execute(s->avctx, mb_var_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
         }
     }
-    for(i=1; i<context_count; i++){
+    for(i=1; i<s->thread_context_count; i++){
         merge_context_after_me(s, s->thread_context[i]);
     }
     s->current_picture.mc_mb_var_sum= s->current_picture_ptr->mc_mb_var_sum= s->me.mc_mb_var_sum_temp;
@@ -29,6 +29,10 @@
  * @see doc/multithreading.txt
  */
 
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/internal.h"
+
 #include "avcodec.h"
 #include "internal.h"
 #include "pthread_internal.h"
@@ -49,6 +53,13 @@ static void validate_thread_parameters(AVCodecContext *avctx)
                                 && !(avctx->flags & CODEC_FLAG_TRUNCATED)
                                 && !(avctx->flags & CODEC_FLAG_LOW_DELAY)
                                 && !(avctx->flags2 & CODEC_FLAG2_CHUNKS);
+
+    /* Encoders declaring frame threading keep no state across frames,
+     * except when collecting statistics or adapting their context model. */
+    if (av_codec_is_encoder(avctx->codec))
+        frame_threading_supported = frame_threading_supported
+                                && !(avctx->flags & (CODEC_FLAG_PASS1 | CODEC_FLAG_PASS2))
+                                && !avctx->context_model;
     if (avctx->thread_count == 1) {
         avctx->active_thread_type = 0;
     } else if (frame_threading_supported && (avctx->thread_type & FF_THREAD_FRAME)) {
@@ -73,15 +84,26 @@ int ff_thread_init(AVCodecContext *avctx)
 
     if (avctx->active_thread_type&FF_THREAD_SLICE)
         return ff_slice_thread_init(avctx);
-    else if (avctx->active_thread_type&FF_THREAD_FRAME)
+    else if (avctx->active_thread_type&FF_THREAD_FRAME) {
+        /* encoder threads are started by avcodec_open2() after init */
+        if (av_codec_is_encoder(avctx->codec)) {
+            if (!avctx->thread_count)
+                avctx->thread_count = FFMIN(av_cpu_count(), MAX_AUTO_THREADS);
+            if (avctx->thread_count <= 1)
+                avctx->active_thread_type = 0;
+            return 0;
+        }
         return ff_frame_thread_init(avctx);
+    }
 
     return 0;
 }
 
 void ff_thread_free(AVCodecContext *avctx)
 {
-    if (avctx->active_thread_type&FF_THREAD_FRAME)
+    if (avctx->active_thread_type&FF_THREAD_FRAME && av_codec_is_encoder(avctx->codec))
+        ff_frame_thread_encoder_free(avctx);
+    else if (avctx->active_thread_type&FF_THREAD_FRAME)
         ff_frame_thread_free(avctx, avctx->thread_count);
     else
         ff_slice_thread_free(avctx);
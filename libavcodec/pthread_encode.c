@@ -0,0 +1,382 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Frame multithreading support functions for intra-only encoders
+ * @see doc/multithreading.txt
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "compat/w32pthreads.h"
+#endif
+
+#include "avcodec.h"
+#include "internal.h"
+#include "pthread_internal.h"
+#include "thread.h"
+
+#include "libavutil/common.h"
+#include "libavutil/dict.h"
+#include "libavutil/frame.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+
+/**
+ * A frame submitted for encoding and the packet it results in.
+ */
+typedef struct EncodeTask {
+    AVFrame *frame;     ///< input frame, NULL once encoded
+    AVPacket pkt;       ///< output packet
+    int got_packet;
+    int ret;
+    int done;           ///< set by the worker once pkt is ready
+
+    /* coded_frame properties and error statistics of the worker context,
+     * returned to the parent context along with the packet */
+    int      quality;
+    int      pict_type;
+    int      key_frame;
+    uint64_t coded_error[AV_NUM_DATA_POINTERS];
+    uint64_t error[AV_NUM_DATA_POINTERS];   ///< added to avctx->error
+} EncodeTask;
+
+/**
+ * Context used by the parent context to feed the worker threads.
+ *
+ * Frames are encoded in the order they are submitted, each one by the first
+ * idle worker, using its own copy of the encoder context. Packets are
+ * returned in submission order, which introduces a delay of up to
+ * thread_count - 1 frames.
+ */
+typedef struct FrameThreadEncoder {
+    pthread_t       *workers;
+    AVCodecContext **contexts;  ///< per-worker encoder contexts
+    int              nb_workers;
+
+    EncodeTask      *tasks;     ///< ring of nb_workers tasks
+    unsigned         submitted; ///< number of frames submitted
+    unsigned         started;   ///< number of frames picked by a worker
+    unsigned         returned;  ///< number of packets returned
+
+    pthread_mutex_t  lock;
+    pthread_cond_t   task_cond; ///< signalled when a frame is submitted
+    pthread_cond_t   done_cond; ///< signalled when a packet is ready
+    int              exit;
+} FrameThreadEncoder;
+
+typedef struct WorkerArg {
+    FrameThreadEncoder *c;
+    AVCodecContext     *avctx;
+} WorkerArg;
+
+static void * attribute_align_arg worker(void *arg)
+{
+    FrameThreadEncoder *c = ((WorkerArg *)arg)->c;
+    AVCodecContext *avctx = ((WorkerArg *)arg)->avctx;
+    uint64_t error[AV_NUM_DATA_POINTERS];
+    int i;
+
+    av_free(arg);
+
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        EncodeTask *task;
+
+        while (c->started == c->submitted && !c->exit)
+            pthread_cond_wait(&c->task_cond, &c->lock);
+        if (c->exit)
+            break;
+
+        task = &c->tasks[c->started++ % c->nb_workers];
+        pthread_mutex_unlock(&c->lock);
+
+        memcpy(error, avctx->error, sizeof(error));
+        task->ret = avcodec_encode_video2(avctx, &task->pkt, task->frame,
+                                          &task->got_packet);
+        av_frame_free(&task->frame);
+
+        for (i = 0; i < AV_NUM_DATA_POINTERS; i++)
+            task->error[i] = avctx->error[i] - error[i];
+        if (avctx->coded_frame) {
+            task->quality   = avctx->coded_frame->quality;
+            task->pict_type = avctx->coded_frame->pict_type;
+            task->key_frame = avctx->coded_frame->key_frame;
+            memcpy(task->coded_error, avctx->coded_frame->error,
+                   sizeof(task->coded_error));
+        }
+
+        pthread_mutex_lock(&c->lock);
+        task->done = 1;
+        pthread_cond_broadcast(&c->done_cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
+static void free_worker_context(AVCodecContext *copy)
+{
+    avcodec_close(copy);
+    av_freep(&copy->rc_eq);
+    av_freep(&copy->intra_matrix);
+    av_freep(&copy->inter_matrix);
+    av_freep(&copy->rc_override);
+    av_free(copy);
+}
+
+/**
+ * Open a single-threaded copy of the encoder context, with the same
+ * private options.
+ */
+static int init_worker_context(AVCodecContext *avctx, AVCodecContext **pcopy)
+{
+    const AVCodec *codec = avctx->codec;
+    AVCodecContext *copy;
+    AVDictionary *opts = NULL;
+    const AVOption *opt = NULL;
+    int ret;
+
+    copy = av_mallocz(sizeof(*copy));
+    if (!copy)
+        return AVERROR(ENOMEM);
+
+    if ((ret = avcodec_copy_context(copy, avctx)) < 0) {
+        av_free(copy);
+        return ret;
+    }
+    /* the extradata is generated again by the worker init */
+    av_freep(&copy->extradata);
+    copy->extradata_size = 0;
+    copy->coded_frame    = NULL;
+    copy->stats_out      = NULL;
+    copy->thread_count   = 1;
+    copy->thread_type    = 0;
+
+    if (codec->priv_class) {
+        while ((opt = av_opt_next(avctx->priv_data, opt))) {
+            uint8_t *val;
+
+            if (opt->type == AV_OPT_TYPE_CONST)
+                continue;
+            if ((ret = av_opt_get(avctx->priv_data, opt->name, 0, &val)) < 0)
+                goto fail;
+            ret = av_dict_set(&opts, opt->name, val, AV_DICT_DONT_STRDUP_VAL);
+            if (ret < 0)
+                goto fail;
+        }
+    }
+
+    if ((ret = avcodec_open2(copy, codec, &opts)) < 0)
+        goto fail;
+    av_dict_free(&opts);
+
+    *pcopy = copy;
+    return 0;
+
+fail:
+    av_dict_free(&opts);
+    free_worker_context(copy);
+    return ret;
+}
+
+int ff_frame_thread_encoder_init(AVCodecContext *avctx)
+{
+    int thread_count = avctx->thread_count;
+    FrameThreadEncoder *c;
+    int i, ret;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    avctx->internal->thread_ctx = c;
+
+    c->workers  = av_mallocz(thread_count * sizeof(*c->workers));
+    c->contexts = av_mallocz(thread_count * sizeof(*c->contexts));
+    c->tasks    = av_mallocz(thread_count * sizeof(*c->tasks));
+    if (!c->workers || !c->contexts || !c->tasks) {
+        av_freep(&c->workers);
+        av_freep(&c->contexts);
+        av_freep(&c->tasks);
+        av_freep(&avctx->internal->thread_ctx);
+        return AVERROR(ENOMEM);
+    }
+
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->task_cond, NULL);
+    pthread_cond_init(&c->done_cond, NULL);
+
+    for (i = 0; i < thread_count; i++) {
+        WorkerArg *arg;
+
+        if ((ret = init_worker_context(avctx, &c->contexts[i])) < 0)
+            goto fail;
+
+        arg = av_malloc(sizeof(*arg));
+        if (!arg) {
+            free_worker_context(c->contexts[i]);
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        arg->c     = c;
+        arg->avctx = c->contexts[i];
+
+        if ((ret = pthread_create(&c->workers[i], NULL, worker, arg))) {
+            av_free(arg);
+            free_worker_context(c->contexts[i]);
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        c->nb_workers++;
+    }
+
+    return 0;
+
+fail:
+    av_log(avctx, AV_LOG_ERROR, "Failed to start encoding thread %d\n", i);
+    ff_frame_thread_encoder_free(avctx);
+    return ret;
+}
+
+void ff_frame_thread_encoder_free(AVCodecContext *avctx)
+{
+    FrameThreadEncoder *c = avctx->internal->thread_ctx;
+    int i;
+
+    if (!c)
+        return;
+
+    pthread_mutex_lock(&c->lock);
+    c->exit = 1;
+    pthread_cond_broadcast(&c->task_cond);
+    pthread_mutex_unlock(&c->lock);
+
+    for (i = 0; i < c->nb_workers; i++) {
+        pthread_join(c->workers[i], NULL);
+        free_worker_context(c->contexts[i]);
+    }
+
+    /* tasks submitted but never picked up or returned */
+    for (i = 0; i < avctx->thread_count; i++) {
+        av_frame_free(&c->tasks[i].frame);
+        av_free_packet(&c->tasks[i].pkt);
+    }
+
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->task_cond);
+    pthread_cond_destroy(&c->done_cond);
+
+    av_freep(&c->workers);
+    av_freep(&c->contexts);
+    av_freep(&c->tasks);
+    av_freep(&avctx->internal->thread_ctx);
+}
+
+int ff_thread_encode_video(AVCodecContext *avctx, AVPacket *avpkt,
+                           const AVFrame *frame, int *got_packet_ptr)
+{
+    FrameThreadEncoder *c = avctx->internal->thread_ctx;
+    EncodeTask *task;
+    int i, ret;
+
+    *got_packet_ptr = 0;
+
+    if (frame) {
+        AVFrame *new_frame = av_frame_alloc();
+        if (!new_frame)
+            return AVERROR(ENOMEM);
+        if ((ret = av_frame_ref(new_frame, frame)) < 0) {
+            av_frame_free(&new_frame);
+            return ret;
+        }
+
+        pthread_mutex_lock(&c->lock);
+        task        = &c->tasks[c->submitted++ % c->nb_workers];
+        task->frame = new_frame;
+        task->done  = 0;
+        pthread_cond_signal(&c->task_cond);
+        pthread_mutex_unlock(&c->lock);
+
+        /* keep every worker busy before waiting for the oldest frame */
+        if (c->submitted - c->returned < c->nb_workers)
+            return 0;
+    } else if (c->submitted == c->returned) {
+        return 0;
+    }
+
+    task = &c->tasks[c->returned % c->nb_workers];
+
+    pthread_mutex_lock(&c->lock);
+    while (!task->done)
+        pthread_cond_wait(&c->done_cond, &c->lock);
+    pthread_mutex_unlock(&c->lock);
+
+    c->returned++;
+    ret = task->ret;
+
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++)
+        avctx->error[i] += task->error[i];
+    if (avctx->coded_frame) {
+        avctx->coded_frame->quality   = task->quality;
+        avctx->coded_frame->pict_type = task->pict_type;
+        avctx->coded_frame->key_frame = task->key_frame;
+        memcpy(avctx->coded_frame->error, task->coded_error,
+               sizeof(task->coded_error));
+    }
+
+    if (ret >= 0 && task->got_packet) {
+        if (avpkt->data) {
+            /* user-supplied buffer */
+            if (avpkt->size < task->pkt.size) {
+                av_log(avctx, AV_LOG_ERROR,
+                       "User packet is too small (%d < %d)\n",
+                       avpkt->size, task->pkt.size);
+                ret = AVERROR(EINVAL);
+            } else {
+                memcpy(avpkt->data, task->pkt.data, task->pkt.size);
+                avpkt->size     = task->pkt.size;
+                avpkt->pts      = task->pkt.pts;
+                avpkt->dts      = task->pkt.dts;
+                avpkt->flags    = task->pkt.flags;
+                avpkt->duration = task->pkt.duration;
+                *got_packet_ptr = 1;
+            }
+            av_free_packet(&task->pkt);
+        } else {
+            *avpkt          = task->pkt;
+            *got_packet_ptr = 1;
+        }
+    } else {
+        av_free_packet(&task->pkt);
+    }
+    av_init_packet(&task->pkt);
+    task->pkt.data = NULL;
+    task->pkt.size = 0;
+
+    if (ret >= 0)
+        avctx->frame_number++;
+
+    return ret;
+}
@@ -37,6 +37,7 @@
 #include "pthread_internal.h"
 #include "thread.h"
 
+#include "libavutil/atomic.h"
 #include "libavutil/avassert.h"
 #include "libavutil/buffer.h"
 #include "libavutil/common.h"
@@ -101,6 +102,8 @@ typedef struct FrameThreadContext {
 
     pthread_mutex_t buffer_mutex;  ///< Mutex used to protect get/release_buffer().
 
+    AVBufferPool *progress_pool;   ///< Pool of ThreadFrame.progress buffers.
+
     int next_decoding;             ///< The next context to submit a packet to.
     int next_finished;             ///< The next context to return output from.
 
@@ -437,30 +440,45 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     return (p->result >= 0) ? avpkt->size : p->result;
 }
 
+/*
+ * The progress of each field is followed in the progress buffer by the
+ * lowest progress any thread is waiting for, or INT_MAX if none is.
+ * Progress is reported without locking, the mutex is only taken to wake up
+ * the waiting threads once the lowest awaited progress is reached. Both
+ * sides write their value before reading the other one, with full memory
+ * barriers, so that either the waiting thread sees the new progress or the
+ * reporting thread sees that it must wake it up.
+ */
 void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
-    int *progress = f->progress ? (int*)f->progress->data : NULL;
+    volatile int *progress = f->progress ? (int*)f->progress->data : NULL;
 
     if (!progress || progress[field] >= n) return;
 
-    p = f->owner->internal->thread_ctx;
-
     if (f->owner->debug&FF_DEBUG_THREADS)
         av_log(f->owner, AV_LOG_DEBUG, "%p finished %d field %d\n", progress, n, field);
 
+    avpriv_atomic_int_set(&progress[field], n);
+    if (avpriv_atomic_int_get(&progress[field + 2]) > n)
+        return;
+
+    p = f->owner->internal->thread_ctx;
+
     pthread_mutex_lock(&p->progress_mutex);
-    progress[field] = n;
-    pthread_cond_broadcast(&p->progress_cond);
+    if (progress[field + 2] <= n) {
+        progress[field + 2] = INT_MAX;
+        pthread_cond_broadcast(&p->progress_cond);
+    }
     pthread_mutex_unlock(&p->progress_mutex);
 }
 
 void ff_thread_await_progress(ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
-    int *progress = f->progress ? (int*)f->progress->data : NULL;
+    volatile int *progress = f->progress ? (int*)f->progress->data : NULL;
 
-    if (!progress || progress[field] >= n) return;
+    if (!progress || avpriv_atomic_int_get(&progress[field]) >= n) return;
 
     p = f->owner->internal->thread_ctx;
 
@@ -468,8 +486,13 @@ void ff_thread_await_progress(ThreadFrame *f, int n, int field)
         av_log(f->owner, AV_LOG_DEBUG, "thread awaiting %d field %d from %p\n", n, field, progress);
 
     pthread_mutex_lock(&p->progress_mutex);
-    while (progress[field] < n)
+    for (;;) {
+        if (progress[field + 2] > n)
+            avpriv_atomic_int_set(&progress[field + 2], n);
+        if (avpriv_atomic_int_get(&progress[field]) >= n)
+            break;
         pthread_cond_wait(&p->progress_cond, &p->progress_mutex);
+    }
     pthread_mutex_unlock(&p->progress_mutex);
 }
 
@@ -527,6 +550,10 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
         if (codec->close)
             codec->close(p->avctx);
 
+        if (p->avctx && p->avctx->internal &&
+            p->avctx->internal->slice_thread_ctx)
+            ff_slice_thread_free(p->avctx);
+
         avctx->codec = NULL;
 
         release_delayed_buffers(p);
@@ -555,6 +582,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
     }
 
     av_freep(&fctx->threads);
+    av_buffer_pool_uninit(&fctx->progress_pool);
     pthread_mutex_destroy(&fctx->buffer_mutex);
     av_freep(&avctx->internal->thread_ctx);
 }
@@ -562,6 +590,7 @@ void ff_frame_thread_free(AVCodecContext *avctx, int thread_count)
 int ff_frame_thread_init(AVCodecContext *avctx)
 {
     int thread_count = avctx->thread_count;
+    int slice_threads = 1;
     const AVCodec *codec = avctx->codec;
     AVCodecContext *src = avctx;
     FrameThreadContext *fctx;
@@ -581,6 +610,19 @@ int ff_frame_thread_init(AVCodecContext *avctx)
             thread_count = avctx->thread_count = 1;
     }
 
+    /* Bound the delay by decoding fewer frames at once and give the
+     * remaining threads to the slice threads of each frame thread. */
+    if (avctx->frame_thread_delay > 0 &&
+        thread_count > avctx->frame_thread_delay + 1) {
+        int frame_threads = avctx->frame_thread_delay + 1;
+
+        if (avctx->thread_type & FF_THREAD_SLICE &&
+            codec->caps_internal & FF_CODEC_CAP_FRAME_SLICE_THREADS)
+            slice_threads = FFMIN(thread_count / frame_threads,
+                                  FF_FRAME_SLICE_JOBS);
+        thread_count = avctx->thread_count = frame_threads;
+    }
+
     if (thread_count <= 1) {
         avctx->active_thread_type = 0;
         return 0;
@@ -589,6 +631,12 @@ int ff_frame_thread_init(AVCodecContext *avctx)
     avctx->internal->thread_ctx = fctx = av_mallocz(sizeof(FrameThreadContext));
 
     fctx->threads = av_mallocz(sizeof(PerThreadContext) * thread_count);
+    fctx->progress_pool = av_buffer_pool_init(4 * sizeof(int), NULL);
+    if (!fctx->progress_pool) {
+        av_freep(&fctx->threads);
+        av_freep(&avctx->internal->thread_ctx);
+        return AVERROR(ENOMEM);
+    }
     pthread_mutex_init(&fctx->buffer_mutex, NULL);
     fctx->delaying = 1;
 
@@ -625,8 +673,18 @@ int ff_frame_thread_init(AVCodecContext *avctx)
         }
         *copy->internal = *src->internal;
         copy->internal->thread_ctx = p;
+        copy->internal->slice_thread_ctx = NULL;
         copy->internal->pkt = &p->avpkt;
 
+        if (slice_threads > 1) {
+            copy->thread_count       = slice_threads;
+            copy->active_thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            if (ff_slice_thread_init(copy) < 0) {
+                err = AVERROR(ENOMEM);
+                goto error;
+            }
+        }
+
         if (!i) {
             src = copy;
 
@@ -690,6 +748,70 @@ void ff_thread_flush(AVCodecContext *avctx)
     }
 }
 
+void ff_frame_thread_close_codec(AVCodecContext *avctx)
+{
+    FrameThreadContext *fctx = avctx->internal->thread_ctx;
+    const AVCodec *codec = avctx->codec;
+    int i;
+
+    ff_thread_flush(avctx);
+
+    for (i = 0; i < avctx->thread_count; i++) {
+        PerThreadContext *p = &fctx->threads[i];
+
+        if (codec->close)
+            codec->close(p->avctx);
+        /* the first thread is cleared by the caller, the others are
+         * overwritten by ff_frame_thread_init_codec() or, if it fails
+         * before reaching them, closed again by ff_frame_thread_free() */
+        if (i)
+            memset(p->avctx->priv_data, 0, codec->priv_data_size);
+        release_delayed_buffers(p);
+    }
+}
+
+int ff_frame_thread_init_codec(AVCodecContext *avctx)
+{
+    FrameThreadContext *fctx = avctx->internal->thread_ctx;
+    const AVCodec *codec = avctx->codec;
+    AVCodecContext *src = avctx;
+    int i, err = 0;
+
+    for (i = 0; i < avctx->thread_count; i++) {
+        AVCodecContext *copy = fctx->threads[i].avctx;
+        AVCodecContext tmp   = *copy;
+
+        /* pick up the parameters the user may have changed, but keep what
+         * belongs to this thread */
+        *copy = *src;
+        copy->internal           = tmp.internal;
+        copy->priv_data          = tmp.priv_data;
+        copy->thread_count       = tmp.thread_count;
+        copy->active_thread_type = tmp.active_thread_type;
+        copy->execute            = tmp.execute;
+        copy->execute2           = tmp.execute2;
+
+        if (!i) {
+            src = copy;
+
+            if (codec->init)
+                err = codec->init(copy);
+
+            update_context_from_thread(avctx, copy, 1);
+        } else {
+            memcpy(copy->priv_data, src->priv_data, codec->priv_data_size);
+
+            if (codec->init_thread_copy)
+                err = codec->init_thread_copy(copy);
+        }
+
+        if (err)
+            return err;
+    }
+
+    return 0;
+}
+
 int ff_thread_get_buffer(AVCodecContext *avctx, ThreadFrame *f, int flags)
 {
     PerThreadContext *p = avctx->internal->thread_ctx;
@@ -708,13 +830,14 @@ int ff_thread_get_buffer(AVCodecContext *avctx, ThreadFrame *f, int flags)
 
     if (avctx->internal->allocate_progress) {
         int *progress;
-        f->progress = av_buffer_alloc(2 * sizeof(int));
+        f->progress = av_buffer_pool_get(p->parent->progress_pool);
         if (!f->progress) {
             return AVERROR(ENOMEM);
         }
         progress = (int*)f->progress->data;
 
         progress[0] = progress[1] = -1;
+        progress[2] = progress[3] = INT_MAX;
     }
 
     pthread_mutex_lock(&p->parent->buffer_mutex);
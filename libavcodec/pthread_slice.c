@@ -58,12 +58,17 @@ typedef struct SliceThreadContext {
     unsigned current_execute;
     int current_job;
     int done;
+
+    int *progress;              ///< per-row progress, see ff_slice_thread_init_progress()
+    int progress_count;
+    pthread_mutex_t progress_lock;
+    pthread_cond_t progress_cond;
 } SliceThreadContext;
 
 static void* attribute_align_arg worker(void *v)
 {
     AVCodecContext *avctx = v;
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     unsigned last_execute = 0;
     int our_job = c->job_count;
     int thread_count = avctx->thread_count;
@@ -98,7 +103,7 @@ static void* attribute_align_arg worker(void *v)
 
 void ff_slice_thread_free(AVCodecContext *avctx)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     int i;
 
     pthread_mutex_lock(&c->current_job_lock);
@@ -112,8 +117,11 @@ void ff_slice_thread_free(AVCodecContext *avctx)
     pthread_mutex_destroy(&c->current_job_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
+    pthread_mutex_destroy(&c->progress_lock);
+    pthread_cond_destroy(&c->progress_cond);
+    av_free(c->progress);
     av_free(c->workers);
-    av_freep(&avctx->internal->thread_ctx);
+    av_freep(&avctx->internal->slice_thread_ctx);
 }
 
 static av_always_inline void thread_park_workers(SliceThreadContext *c, int thread_count)
@@ -125,7 +133,7 @@ static av_always_inline void thread_park_workers(SliceThreadContext *c, int thre
 
 static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, int *ret, int job_count, int job_size)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     int dummy_ret;
 
     if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1)
@@ -158,7 +166,7 @@ static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, i
 
 static int thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg, int *ret, int job_count)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
     c->func2 = func2;
     return thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
@@ -198,7 +206,7 @@ int ff_slice_thread_init(AVCodecContext *avctx)
         return -1;
     }
 
-    avctx->internal->thread_ctx = c;
+    avctx->internal->slice_thread_ctx = c;
     c->current_job = 0;
     c->job_count = 0;
     c->job_size = 0;
@@ -206,12 +214,14 @@ int ff_slice_thread_init(AVCodecContext *avctx)
     pthread_cond_init(&c->current_job_cond, NULL);
     pthread_cond_init(&c->last_job_cond, NULL);
     pthread_mutex_init(&c->current_job_lock, NULL);
+    pthread_mutex_init(&c->progress_lock, NULL);
+    pthread_cond_init(&c->progress_cond, NULL);
     pthread_mutex_lock(&c->current_job_lock);
     for (i=0; i<thread_count; i++) {
         if(pthread_create(&c->workers[i], NULL, worker, avctx)) {
            avctx->thread_count = i;
            pthread_mutex_unlock(&c->current_job_lock);
-           ff_thread_free(avctx);
+           ff_slice_thread_free(avctx);
            return -1;
         }
     }
@@ -222,3 +232,54 @@ int ff_slice_thread_init(AVCodecContext *avctx)
     avctx->execute2 = thread_execute2;
     return 0;
 }
+
+int ff_slice_thread_init_progress(AVCodecContext *avctx, int count)
+{
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
+    int i;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) || avctx->thread_count <= 1)
+        return 0;
+
+    if (c->progress_count < count) {
+        av_freep(&c->progress);
+        c->progress_count = 0;
+        c->progress = av_malloc(count * sizeof(*c->progress));
+        if (!c->progress)
+            return AVERROR(ENOMEM);
+        c->progress_count = count;
+    }
+    for (i = 0; i < count; i++)
+        c->progress[i] = -1;
+
+    return 0;
+}
+
+void ff_slice_thread_report_progress(AVCodecContext *avctx, int row, int n)
+{
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) || !c->progress)
+        return;
+
+    pthread_mutex_lock(&c->progress_lock);
+    c->progress[row] = n;
+    pthread_cond_broadcast(&c->progress_cond);
+    pthread_mutex_unlock(&c->progress_lock);
+}
+
+int ff_slice_thread_await_progress(AVCodecContext *avctx, int row, int n)
+{
+    SliceThreadContext *c = avctx->internal->slice_thread_ctx;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) || !c->progress)
+        return n;
+
+    pthread_mutex_lock(&c->progress_lock);
+    while (c->progress[row] < n)
+        pthread_cond_wait(&c->progress_cond, &c->progress_lock);
+    n = c->progress[row];
+    pthread_mutex_unlock(&c->progress_lock);
+
+    return n;
+}
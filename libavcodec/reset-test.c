@@ -0,0 +1,470 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Check that a decoder reinitialized with avcodec_reset() for a new stream
+ * gives the same output as a freshly opened one.
+ *
+ * Given a decoder name and a raw bitstream file, check instead that
+ * decoding the file again from its start after a flush or a reset in the
+ * middle of it gives the same output as the first decoding.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/frame.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/samplefmt.h"
+#include "avcodec.h"
+
+#define MAX_PACKETS 256
+
+typedef struct Stream {
+    AVPacket pkts[MAX_PACKETS];
+    int nb_pkts;
+} Stream;
+
+static int fill_frame(AVFrame *frame, enum AVMediaType type, int n)
+{
+    int channels = av_get_channel_layout_nb_channels(frame->channel_layout);
+    int ret, x, y, ch;
+
+    if ((ret = av_frame_get_buffer(frame, 32)) < 0)
+        return ret;
+
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        for (y = 0; y < frame->height; y++)
+            for (x = 0; x < frame->width; x++)
+                frame->data[0][y * frame->linesize[0] + x] = x * 3 + y + n * 5;
+        for (y = 0; y < frame->height / 2; y++) {
+            for (x = 0; x < frame->width / 2; x++) {
+                frame->data[1][y * frame->linesize[1] + x] = 128 + y - n * 2;
+                frame->data[2][y * frame->linesize[2] + x] = 64 + x + n * 3;
+            }
+        }
+    } else {
+        for (ch = 0; ch < channels; ch++) {
+            int16_t *samples = (int16_t *)frame->data[0] + ch;
+            for (x = 0; x < frame->nb_samples; x++)
+                samples[x * channels] =
+                    ((n * frame->nb_samples + x) * (ch + 3) * 97) % 12000 - 6000;
+        }
+    }
+    return 0;
+}
+
+/* encode nb_frames frames of a synthetic stream, storing the packets in st */
+static int encode_stream(Stream *st, enum AVCodecID codec_id, int width,
+                         int height, int sample_rate, int channels,
+                         int nb_frames)
+{
+    AVCodec *codec = avcodec_find_encoder(codec_id);
+    AVCodecContext *avctx;
+    AVFrame *frame = NULL;
+    int i, ret, got_packet;
+
+    if (!codec || !(avctx = avcodec_alloc_context3(codec)))
+        return AVERROR(ENOMEM);
+
+    if (codec->type == AVMEDIA_TYPE_VIDEO) {
+        avctx->width        = width;
+        avctx->height       = height;
+        avctx->pix_fmt      = AV_PIX_FMT_YUV420P;
+        avctx->time_base    = (AVRational){ 1, 25 };
+        avctx->gop_size     = 5;
+        avctx->max_b_frames = 2;
+    } else {
+        avctx->sample_rate    = sample_rate;
+        avctx->channels       = channels;
+        avctx->channel_layout = av_get_default_channel_layout(channels);
+        avctx->sample_fmt     = AV_SAMPLE_FMT_S16;
+        avctx->bit_rate       = 64000 * channels;
+    }
+    avctx->flags |= CODEC_FLAG_BITEXACT;
+    if ((ret = avcodec_open2(avctx, codec, NULL)) < 0)
+        goto end;
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    st->nb_pkts = 0;
+    for (i = 0; st->nb_pkts < MAX_PACKETS; i++) {
+        AVPacket *pkt = &st->pkts[st->nb_pkts];
+        AVFrame *in   = NULL;
+
+        if (i < nb_frames) {
+            av_frame_unref(frame);
+            if (codec->type == AVMEDIA_TYPE_VIDEO) {
+                frame->width  = avctx->width;
+                frame->height = avctx->height;
+                frame->format = avctx->pix_fmt;
+            } else {
+                frame->nb_samples     = avctx->frame_size;
+                frame->channel_layout = avctx->channel_layout;
+                frame->format         = avctx->sample_fmt;
+            }
+            if ((ret = fill_frame(frame, codec->type, i)) < 0)
+                goto end;
+            frame->pts = i;
+            in = frame;
+        }
+
+        av_init_packet(pkt);
+        pkt->data = NULL;
+        pkt->size = 0;
+        if (codec->type == AVMEDIA_TYPE_VIDEO)
+            ret = avcodec_encode_video2(avctx, pkt, in, &got_packet);
+        else
+            ret = avcodec_encode_audio2(avctx, pkt, in, &got_packet);
+        if (ret < 0)
+            goto end;
+        if (got_packet)
+            st->nb_pkts++;
+        else if (!in)
+            break;
+    }
+
+end:
+    av_frame_free(&frame);
+    avcodec_close(avctx);
+    av_free(avctx);
+    return ret;
+}
+
+/* decode the first nb_pkts packets of st, storing a checksum of every output
+ * frame in sums, draining the decoder if nb_pkts covers the whole stream */
+static int decode_stream(AVCodecContext *avctx, Stream *st, int nb_pkts,
+                         uint32_t *sums, int *nb_sums)
+{
+    AVFrame *frame = av_frame_alloc();
+    int i, ret = 0, got_frame;
+
+    *nb_sums = 0;
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i <= nb_pkts; i++) {
+        AVPacket pkt;
+
+        if (i < nb_pkts) {
+            pkt = st->pkts[i];
+        } else if (nb_pkts == st->nb_pkts) {
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+        } else {
+            break;
+        }
+
+        do {
+            if (avctx->codec_type == AVMEDIA_TYPE_VIDEO)
+                ret = avcodec_decode_video2(avctx, frame, &got_frame, &pkt);
+            else
+                ret = avcodec_decode_audio4(avctx, frame, &got_frame, &pkt);
+            if (ret < 0)
+                goto end;
+
+            if (got_frame) {
+                uint32_t sum = 0;
+                int p, y;
+
+                if (avctx->codec_type == AVMEDIA_TYPE_VIDEO) {
+                    const AVPixFmtDescriptor *desc =
+                        av_pix_fmt_desc_get(frame->format);
+                    int bytes = desc->comp[0].depth_minus1 >= 8 ? 2 : 1;
+
+                    for (p = 0; p < 3; p++) {
+                        int h = p ? -((-frame->height) >> desc->log2_chroma_h) :
+                                    frame->height;
+                        int w = p ? -((-frame->width)  >> desc->log2_chroma_w) :
+                                    frame->width;
+                        for (y = 0; y < h; y++)
+                            sum = av_adler32_update(sum, frame->data[p] +
+                                                    y * frame->linesize[p],
+                                                    w * bytes);
+                    }
+                } else {
+                    int planar = av_sample_fmt_is_planar(frame->format);
+                    int size   = frame->nb_samples *
+                                 av_get_bytes_per_sample(frame->format) *
+                                 (planar ? 1 : avctx->channels);
+                    for (p = 0; p < (planar ? avctx->channels : 1); p++)
+                        sum = av_adler32_update(sum, frame->extended_data[p],
+                                                size);
+                }
+                if (*nb_sums < 2 * MAX_PACKETS)
+                    sums[(*nb_sums)++] = sum;
+                av_frame_unref(frame);
+            }
+            if (i < nb_pkts) {
+                pkt.data += ret;
+                pkt.size -= ret;
+            }
+        } while (i < nb_pkts ? pkt.size > 0 : got_frame);
+    }
+    ret = 0;
+
+end:
+    av_frame_free(&frame);
+    return ret;
+}
+
+static AVCodecContext *open_decoder(enum AVCodecID codec_id, int threads)
+{
+    AVCodec *codec = avcodec_find_decoder(codec_id);
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+
+    if (!avctx)
+        return NULL;
+    avctx->refcounted_frames = 1;
+    avctx->thread_count      = threads;
+    avctx->thread_type       = FF_THREAD_FRAME;
+    if (avcodec_open2(avctx, codec, NULL) < 0) {
+        av_free(avctx);
+        return NULL;
+    }
+    return avctx;
+}
+
+static void free_decoder(AVCodecContext **avctx)
+{
+    if (*avctx)
+        avcodec_close(*avctx);
+    av_freep(avctx);
+}
+
+/* decode part of first, then all of second after a reset or a flush, and
+ * compare with a decoder that only saw second */
+static int test_reset(enum AVCodecID codec_id, int threads,
+                      Stream *first, Stream *second, int flush)
+{
+    uint32_t ref[2 * MAX_PACKETS], out[2 * MAX_PACKETS];
+    int nb_ref, nb_out, ret;
+    AVCodecContext *avctx = open_decoder(codec_id, threads);
+
+    if (!avctx)
+        return AVERROR(ENOMEM);
+    if ((ret = decode_stream(avctx, second, second->nb_pkts, ref, &nb_ref)) < 0)
+        goto end;
+    free_decoder(&avctx);
+
+    if (!(avctx = open_decoder(codec_id, threads))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if ((ret = decode_stream(avctx, first, first->nb_pkts / 2,
+                             out, &nb_out)) < 0)
+        goto end;
+    if (flush)
+        avcodec_flush_buffers(avctx);
+    else if ((ret = avcodec_reset(avctx)) < 0)
+        goto end;
+    if ((ret = decode_stream(avctx, second, second->nb_pkts,
+                             out, &nb_out)) < 0)
+        goto end;
+
+    printf("%s, %d thread%s: %d frames, %s output after %s\n",
+           avctx->codec->name, threads, threads > 1 ? "s" : "", nb_ref,
+           nb_ref == nb_out && !memcmp(ref, out, nb_ref * sizeof(*ref)) ?
+           "same" : "different", flush ? "flush" : "reset");
+
+end:
+    free_decoder(&avctx);
+    return ret;
+}
+
+/* split a raw bitstream file into packets with the parser for codec */
+static int read_stream(Stream *st, const AVCodec *codec, const char *filename)
+{
+    AVCodecContext *avctx = avcodec_alloc_context3(codec);
+    AVCodecParserContext *parser = av_parser_init(codec->id);
+    FILE *f = fopen(filename, "rb");
+    uint8_t *buf = NULL, *data;
+    long size = 0, pos = 0;
+    int data_size, len, ret = 0;
+
+    st->nb_pkts = 0;
+    if (!avctx || !parser) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (!f || fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0 ||
+        fseek(f, 0, SEEK_SET)) {
+        fprintf(stderr, "Cannot read %s\n", filename);
+        ret = AVERROR(EIO);
+        goto end;
+    }
+    if (!(buf = av_mallocz(size + FF_INPUT_BUFFER_PADDING_SIZE))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (fread(buf, 1, size, f) != size) {
+        ret = AVERROR(EIO);
+        goto end;
+    }
+
+    /* the parser returns the last frame once called with no input left */
+    for (;;) {
+        int left = size - pos;
+
+        len = av_parser_parse2(parser, avctx, &data, &data_size,
+                               buf + pos, left,
+                               AV_NOPTS_VALUE, AV_NOPTS_VALUE, pos);
+        pos += len;
+        if (!data_size) {
+            if (!left)
+                break;
+            continue;
+        }
+        if (st->nb_pkts == MAX_PACKETS) {
+            fprintf(stderr, "More than %d packets in %s\n", MAX_PACKETS,
+                    filename);
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = av_new_packet(&st->pkts[st->nb_pkts], data_size)) < 0)
+            goto end;
+        memcpy(st->pkts[st->nb_pkts++].data, data, data_size);
+    }
+
+end:
+    if (f)
+        fclose(f);
+    av_free(buf);
+    av_parser_close(parser);
+    av_free(avctx);
+    return ret;
+}
+
+/* a reset that fails has to leave a closed context behind */
+static int test_reset_failure(enum AVCodecID codec_id, int threads,
+                              const uint8_t *config, int config_size)
+{
+    AVCodecContext *avctx = open_decoder(codec_id, threads);
+    const AVCodec *codec;
+    int ret;
+
+    if (!avctx)
+        return AVERROR(ENOMEM);
+    codec = avctx->codec;
+
+    avctx->extradata = av_mallocz(config_size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!avctx->extradata) {
+        free_decoder(&avctx);
+        return AVERROR(ENOMEM);
+    }
+    memcpy(avctx->extradata, config, config_size);
+    avctx->extradata_size = config_size;
+
+    ret = avcodec_reset(avctx);
+    printf("%s, %d thread%s: reset with invalid extradata %s, context %s\n",
+           codec->name, threads, threads > 1 ? "s" : "",
+           ret < 0 ? "failed" : "succeeded",
+           avcodec_is_open(avctx) ? "open" : "closed");
+
+    av_freep(&avctx->extradata);
+    avctx->extradata_size = 0;
+    ret = avcodec_open2(avctx, codec, NULL);
+    printf("%s, %d thread%s: reopen %s\n", codec->name, threads,
+           threads > 1 ? "s" : "", ret < 0 ? "failed" : "succeeded");
+
+    free_decoder(&avctx);
+    return ret;
+}
+
+static int test_file(const char *name, const char *filename)
+{
+    static Stream st;
+    AVCodec *codec = avcodec_find_decoder_by_name(name);
+    int i, threads, flush, ret;
+
+    if (!codec) {
+        fprintf(stderr, "Unknown decoder %s\n", name);
+        return 1;
+    }
+    if ((ret = read_stream(&st, codec, filename)) >= 0) {
+        for (threads = 1; threads <= 2 && ret >= 0; threads++)
+            for (flush = 1; flush >= 0 && ret >= 0; flush--)
+                if ((ret = test_reset(codec->id, threads, &st, &st,
+                                      flush)) < 0)
+                    fprintf(stderr, "Decoding %s failed\n", filename);
+    }
+    for (i = 0; i < st.nb_pkts; i++)
+        av_free_packet(&st.pkts[i]);
+    return ret < 0;
+}
+
+int main(int argc, char **argv)
+{
+    static Stream streams[2];
+    static const enum AVCodecID codecs[2] = { AV_CODEC_ID_MPEG4,
+                                              AV_CODEC_ID_MP2 };
+    static const uint8_t aac_config[2]  = { 0xF8, 0x00 };
+    static const uint8_t h264_config[8] = { 0x01, 0x42, 0x00, 0x1E,
+                                            0xFF, 0xE1, 0x01, 0x00 };
+    int c, i, j, threads, ret = 0;
+
+    avcodec_register_all();
+    av_log_set_level(AV_LOG_QUIET);
+
+    if (argc > 2)
+        return test_file(argv[1], argv[2]);
+
+    for (c = 0; c < 2 && ret >= 0; c++) {
+        if ((ret = encode_stream(&streams[0], codecs[c], 64, 48,
+                                 44100, 1, 12)) < 0 ||
+            (ret = encode_stream(&streams[1], codecs[c], 96, 80,
+                                 48000, 2, 12)) < 0) {
+            fprintf(stderr, "Encoding the %s test streams failed\n",
+                    avcodec_descriptor_get(codecs[c])->name);
+            return 1;
+        }
+
+        for (threads = 1; threads <= 2 && ret >= 0; threads++)
+            if ((ret = test_reset(codecs[c], threads, &streams[0],
+                                  &streams[1], 0)) < 0)
+                fprintf(stderr, "Decoding the %s test streams failed\n",
+                        avcodec_descriptor_get(codecs[c])->name);
+
+        for (i = 0; i < 2; i++)
+            for (j = 0; j < streams[i].nb_pkts; j++)
+                av_free_packet(&streams[i].pkts[j]);
+    }
+
+    /* an unsupported audio object type */
+    if (ret >= 0 &&
+        (ret = test_reset_failure(AV_CODEC_ID_AAC, 1, aac_config,
+                                  sizeof(aac_config))) < 0)
+        fprintf(stderr, "Reopening the AAC decoder failed\n");
+    /* an avcC with an SPS running past its end */
+    if (ret >= 0 &&
+        (ret = test_reset_failure(AV_CODEC_ID_H264, 2, h264_config,
+                                  sizeof(h264_config))) < 0)
+        fprintf(stderr, "Reopening the H.264 decoder failed\n");
+
+    return ret < 0;
+}
@@ -36,7 +36,7 @@ typedef struct ThreadFrame {
     AVFrame *f;
     AVCodecContext *owner;
     // progress->data is an array of 2 ints holding progress for top/bottom
-    // fields
+    // fields, followed by 2 ints used internally to wake up waiting threads
     AVBufferRef *progress;
 } ThreadFrame;
 
@@ -48,6 +48,35 @@ typedef struct ThreadFrame {
  */
 void ff_thread_flush(AVCodecContext *avctx);
 
+/**
+ * Wait for decoding threads to finish and close the decoder in each of them.
+ * The threads are kept running, ff_frame_thread_init_codec() must be called
+ * before decoding again.
+ */
+void ff_frame_thread_close_codec(AVCodecContext *avctx);
+
+/**
+ * Initialize the decoder again in each frame thread, after
+ * ff_frame_thread_close_codec(), using the parameters currently set in avctx.
+ */
+int ff_frame_thread_init_codec(AVCodecContext *avctx);
+
+/**
+ * Start the frame threads of an intra-only encoder.
+ * Must be called after the encoder has been initialized.
+ */
+int ff_frame_thread_encoder_init(AVCodecContext *avctx);
+
+/**
+ * Submit a new frame to an encoding thread.
+ * Returns the next available packet in avpkt. *got_packet_ptr
+ * will be 0 if none is available.
+ *
+ * Parameters are the same as avcodec_encode_video2().
+ */
+int ff_thread_encode_video(AVCodecContext *avctx, AVPacket *avpkt,
+                           const AVFrame *frame, int *got_packet_ptr);
+
 /**
  * Submit a new frame to a decoding thread.
  * Returns the next available frame in picture. *got_picture_ptr
@@ -125,4 +154,31 @@ int ff_thread_ref_frame(ThreadFrame *dst, ThreadFrame *src);
 int ff_thread_init(AVCodecContext *s);
 void ff_thread_free(AVCodecContext *s);
 
+/**
+ * Reset the row progress counters of slice threading, allowing the jobs of
+ * the next execute2() call to synchronize with each other, e.g. to process
+ * macroblock rows as a wavefront.
+ *
+ * Jobs are started in increasing order, so a job may wait for the progress
+ * of an earlier job without risking a deadlock, but not for a later one.
+ * This is a no-op unless slice threading is active.
+ *
+ * @param count number of rows
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_slice_thread_init_progress(AVCodecContext *avctx, int count);
+
+/**
+ * Notify the jobs waiting for a row that n units of it are complete.
+ */
+void ff_slice_thread_report_progress(AVCodecContext *avctx, int row, int n);
+
+/**
+ * Wait until at least n units of a row are reported complete.
+ *
+ * @return the last progress reported for the row, or n if slice threading
+ *         is not active
+ */
+int ff_slice_thread_await_progress(AVCodecContext *avctx, int row, int n);
+
 #endif /* AVCODEC_THREAD_H */
@@ -371,14 +371,24 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
         size[i] = tmpsize - (picture.data[i] - picture.data[0]);
 
         for (i = 0; i < 4; i++) {
-            av_buffer_pool_uninit(&pool->pools[i]);
             pool->linesize[i] = picture.linesize[i];
+
+            /* Keep the pools whose buffers are still large enough, unless
+             * most of their memory would be wasted. */
+            if (pool->pools[i] && size[i] &&
+                size[i] + 16 <= pool->buf_size[i] &&
+                4 * (size[i] + 16) >= pool->buf_size[i])
+                continue;
+
+            av_buffer_pool_uninit(&pool->pools[i]);
+            pool->buf_size[i] = 0;
             if (size[i]) {
                 pool->pools[i] = av_buffer_pool_init(size[i] + 16, NULL);
                 if (!pool->pools[i]) {
                     ret = AVERROR(ENOMEM);
                     goto fail;
                 }
+                pool->buf_size[i] = size[i] + 16;
             }
         }
         pool->format = frame->format;
@@ -1102,7 +1112,8 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
             avctx->rc_initial_buffer_occupancy = avctx->rc_buffer_size * 3 / 4;
     }
 
-    if (avctx->codec->init && !(avctx->active_thread_type & FF_THREAD_FRAME)) {
+    if (avctx->codec->init && (!(avctx->active_thread_type & FF_THREAD_FRAME) ||
+                               av_codec_is_encoder(avctx->codec))) {
         ret = avctx->codec->init(avctx);
         if (ret < 0) {
             goto free_and_end;
@@ -1139,6 +1150,15 @@ end:
         *options = tmp;
     }
 
+    /* the encoder threads open their own contexts, so they are started
+     * once the lock is released */
+    if (HAVE_THREADS && ret >= 0 && av_codec_is_encoder(avctx->codec) &&
+        avctx->active_thread_type & FF_THREAD_FRAME) {
+        ret = ff_frame_thread_encoder_init(avctx);
+        if (ret < 0)
+            avcodec_close(avctx);
+    }
+
     return ret;
 free_and_end:
     av_dict_free(&tmp);
@@ -1329,6 +1349,20 @@ int attribute_align_arg avcodec_encode_video2(AVCodecContext *avctx,
 
     *got_packet_ptr = 0;
 
+    if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME) {
+        if (frame && av_image_check_size(avctx->width, avctx->height, 0, avctx))
+            return AVERROR(EINVAL);
+
+        ret = ff_thread_encode_video(avctx, avpkt, frame, got_packet_ptr);
+        if (ret < 0 || !*got_packet_ptr) {
+            av_free_packet(avpkt);
+            av_init_packet(avpkt);
+            avpkt->size = 0;
+        }
+        emms_c();
+        return ret;
+    }
+
     if (!(avctx->codec->capabilities & CODEC_CAP_DELAY) && !frame) {
         av_free_packet(avpkt);
         av_init_packet(avpkt);
@@ -1635,7 +1669,8 @@ av_cold int avcodec_close(AVCodecContext *avctx)
     if (avcodec_is_open(avctx)) {
         FramePool *pool = avctx->internal->pool;
         int i;
-        if (HAVE_THREADS && avctx->internal->thread_ctx)
+        if (HAVE_THREADS && (avctx->internal->thread_ctx ||
+                             avctx->internal->slice_thread_ctx))
             ff_thread_free(avctx);
         if (avctx->codec && avctx->codec->close)
             avctx->codec->close(avctx);
@@ -1664,6 +1699,100 @@ av_cold int avcodec_close(AVCodecContext *avctx)
     return 0;
 }
 
+int avcodec_reset(AVCodecContext *avctx)
+{
+    const AVCodec *codec = avctx->codec;
+    const AVOption *opt  = NULL;
+    AVDictionary *opts   = NULL;
+    int ret = 0;
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(codec))
+        return AVERROR(EINVAL);
+
+    /* the private options are kept across the reinitialization */
+    if (codec->priv_class) {
+        while ((opt = av_opt_next(avctx->priv_data, opt))) {
+            uint8_t *val;
+
+            if (opt->type == AV_OPT_TYPE_CONST)
+                continue;
+            if ((ret = av_opt_get(avctx->priv_data, opt->name, 0, &val)) < 0) {
+                av_dict_free(&opts);
+                return ret;
+            }
+            av_dict_set(&opts, opt->name, val, AV_DICT_DONT_STRDUP_VAL);
+        }
+    }
+
+    if (lockmgr_cb) {
+        if ((*lockmgr_cb)(&codec_mutex, AV_LOCK_OBTAIN)) {
+            av_dict_free(&opts);
+            return -1;
+        }
+    }
+
+    entangled_thread_counter++;
+    if (entangled_thread_counter != 1) {
+        av_log(avctx, AV_LOG_ERROR, "insufficient thread locking around avcodec_open/close()\n");
+        ret = -1;
+        goto end;
+    }
+
+    /* the first frame thread shares its private context with avctx */
+    if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME)
+        ff_frame_thread_close_codec(avctx);
+    else if (codec->close)
+        codec->close(avctx);
+    if (codec->priv_class)
+        av_opt_free(avctx->priv_data);
+    memset(avctx->priv_data, 0, codec->priv_data_size);
+    if (codec->priv_class) {
+        *(const AVClass **)avctx->priv_data = codec->priv_class;
+        av_opt_set_defaults(avctx->priv_data);
+        if ((ret = av_opt_set_dict(avctx->priv_data, &opts)) < 0)
+            goto fail;
+    }
+
+    av_frame_unref(avctx->internal->to_free);
+    avctx->frame_number = 0;
+
+    if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_FRAME)
+        ret = ff_frame_thread_init_codec(avctx);
+    else if (codec->init)
+        ret = codec->init(avctx);
+    if (ret < 0)
+        goto fail;
+
+end:
+    entangled_thread_counter--;
+
+    if (lockmgr_cb) {
+        (*lockmgr_cb)(&codec_mutex, AV_LOCK_RELEASE);
+    }
+    av_dict_free(&opts);
+    return ret;
+
+fail:
+    /* The decoder is closed or half initialized. Free it the way a failed
+     * avcodec_open2() does, without closing it again outside of the frame
+     * threads, and close the context once the lock is released. */
+    if (HAVE_THREADS && (avctx->internal->thread_ctx ||
+                         avctx->internal->slice_thread_ctx))
+        ff_thread_free(avctx);
+    avctx->codec = NULL;
+
+    entangled_thread_counter--;
+
+    if (lockmgr_cb) {
+        (*lockmgr_cb)(&codec_mutex, AV_LOCK_RELEASE);
+    }
+    av_dict_free(&opts);
+    if (codec->priv_class)
+        av_opt_free(avctx->priv_data);
+    avcodec_close(avctx);
+    return ret;
+}
+
 static AVCodec *find_encdec(enum AVCodecID id, int encoder)
 {
     AVCodec *p, *experimental = NULL;
@@ -2309,6 +2438,20 @@ void ff_thread_await_progress(ThreadFrame *f, int progress, int field)
 {
 }
 
+int ff_slice_thread_init_progress(AVCodecContext *avctx, int count)
+{
+    return 0;
+}
+
+void ff_slice_thread_report_progress(AVCodecContext *avctx, int row, int n)
+{
+}
+
+int ff_slice_thread_await_progress(AVCodecContext *avctx, int row, int n)
+{
+    return n;
+}
+
 #endif
 
 enum AVMediaType avcodec_get_type(enum AVCodecID codec_id)
@@ -22,6 +22,7 @@
 #include "libavutil/attributes.h"
 #include "libavutil/cpu.h"
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "libavutil/x86/asm.h"
 #include "libavutil/x86/cpu.h"
 #include "libavcodec/mpegaudiodsp.h"
@@ -224,11 +225,10 @@ DECL_IMDCT_BLOCKS(ssse3,sse)
 DECL_IMDCT_BLOCKS(avx,avx)
 #endif /* HAVE_YASM */
 
-av_cold void ff_mpadsp_init_x86(MPADSPContext *s)
+static av_cold void mpadsp_init_x86_static(void)
 {
-    int cpu_flags = av_get_cpu_flags();
-
     int i, j;
+
     for (j = 0; j < 4; j++) {
         for (i = 0; i < 40; i ++) {
             mdct_win_sse[0][j][4*i    ] = ff_mdct_win_float[j    ][i];
@@ -241,6 +241,14 @@ av_cold void ff_mpadsp_init_x86(MPADSPContext *s)
             mdct_win_sse[1][j][4*i + 3] = ff_mdct_win_float[j + 4][i];
         }
     }
+}
+
+av_cold void ff_mpadsp_init_x86(MPADSPContext *s)
+{
+    static AVOnce init_static_once = AV_ONCE_INIT;
+    int cpu_flags = av_get_cpu_flags();
+
+    ff_thread_once(&init_static_once, mpadsp_init_x86_static);
 
 #if HAVE_SSE2_INLINE
     if (INLINE_SSE2(cpu_flags)) {
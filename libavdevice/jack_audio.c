@@ -63,7 +63,8 @@ static int process_callback(jack_nframes_t nframes, void *arg)
     JackData *self = arg;
     float * buffer;
     jack_nframes_t latency, cycle_delay;
-    AVPacket pkt;
+    AVPacket *pkt;
+    uint8_t *ptr;
     float *pkt_data;
     double cycle_time;
 
@@ -79,15 +80,19 @@ static int process_callback(jack_nframes_t nframes, void *arg)
                                       self->buffer_size);
 
     /* Check if an empty packet is available, and if there's enough space to send it back once filled */
-    if ((av_fifo_size(self->new_pkts) < sizeof(pkt)) || (av_fifo_space(self->filled_pkts) < sizeof(pkt))) {
+    if ((av_fifo_size(self->new_pkts) < sizeof(*pkt)) ||
+        (av_fifo_write_window(self->filled_pkts, &ptr) < sizeof(*pkt))) {
         self->pkt_xrun = 1;
         return 0;
     }
 
-    /* Retrieve empty (but allocated) packet */
-    av_fifo_generic_read(self->new_pkts, &pkt, sizeof(pkt), NULL);
+    /* Retrieve empty (but allocated) packet, straight into its slot in the
+     * filled packets FIFO. The FIFO holds a whole number of packets, so
+     * a slot never wraps around. */
+    pkt = (AVPacket *)ptr;
+    av_fifo_generic_read(self->new_pkts, pkt, sizeof(*pkt), NULL);
 
-    pkt_data  = (float *) pkt.data;
+    pkt_data  = (float *) pkt->data;
     latency   = 0;
 
     /* Copy and interleave audio data from the JACK buffer into the packet */
@@ -105,10 +110,10 @@ static int process_callback(jack_nframes_t nframes, void *arg)
     }
 
     /* Timestamp the packet with the cycle start time minus the average latency */
-    pkt.pts = (cycle_time - (double) latency / (self->nports * self->sample_rate)) * 1000000.0;
+    pkt->pts = (cycle_time - (double) latency / (self->nports * self->sample_rate)) * 1000000.0;
 
     /* Send the now filled packet back, and increase packet counter */
-    av_fifo_generic_write(self->filled_pkts, &pkt, sizeof(pkt), NULL);
+    av_fifo_commit(self->filled_pkts, sizeof(*pkt));
     sem_post(&self->packet_count);
 
     return 0;
@@ -195,10 +200,12 @@ static int start_jack(AVFormatContext *context)
         return AVERROR(ENOMEM);
     }
 
-    /* Create FIFO buffers */
-    self->filled_pkts = av_fifo_alloc(FIFO_PACKETS_NUM * sizeof(AVPacket));
+    /* Create FIFO buffers, shared locklessly with the JACK process thread */
+    self->filled_pkts = av_fifo_alloc2(FIFO_PACKETS_NUM * sizeof(AVPacket),
+                                       AV_FIFO_FLAG_SPSC);
     /* New packets FIFO with one extra packet for safety against underruns */
-    self->new_pkts    = av_fifo_alloc((FIFO_PACKETS_NUM + 1) * sizeof(AVPacket));
+    self->new_pkts    = av_fifo_alloc2((FIFO_PACKETS_NUM + 1) * sizeof(AVPacket),
+                                       AV_FIFO_FLAG_SPSC);
     if ((test = supply_new_packets(self, context))) {
         jack_client_close(self->client);
         return test;
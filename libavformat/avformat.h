@@ -1134,6 +1134,19 @@ typedef struct AVFormatContext {
      */
     int64_t max_interleave_delta;
 
+    /**
+     * Maximum number of packets of a single stream buffered for interleaving.
+     *
+     * Like max_interleave_delta, this bounds the amount of buffering done by
+     * av_interleaved_write_frame() when some streams are sparse or badly
+     * interleaved: once a stream has more packets than this in the muxing
+     * queue, libavformat will output a packet regardless of whether it has
+     * queued a packet for all the streams. 0 means no limit.
+     *
+     * Muxing only, set by the caller before avformat_write_header().
+     */
+    int max_interleave_packets;
+
     /*****************************************************************
      * All fields below this line are not part of the public API. They
      * may not be used outside of libavformat and can be changed and
@@ -1405,6 +1418,45 @@ int avformat_open_input(AVFormatContext **ps, const char *filename, AVInputForma
  */
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options);
 
+/**
+ * Serialize the stream layout (codec parameters, extradata and time bases of
+ * every stream) of an input, so that a later open of an input with the same
+ * layout can skip avformat_find_stream_info().
+ * Should be called after avformat_find_stream_info() succeeded.
+ *
+ * @param ic   media file handle
+ * @param buf  pointer set to an av_malloc()ed buffer holding the layout,
+ *             to be freed with av_free()
+ * @param size pointer set to the size of buf
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int avformat_get_stream_layout(AVFormatContext *ic, uint8_t **buf, int *size);
+
+/**
+ * Try to fill the stream information from a layout previously obtained with
+ * avformat_get_stream_layout() instead of probing it with
+ * avformat_find_stream_info().
+ *
+ * The layout is validated against the input: the demuxer must be the same
+ * and every stream of the layout must exist with the same id, media type and
+ * codec, and deliver a packet within probesize bytes. Packets read for the
+ * validation are buffered for later processing, as in
+ * avformat_find_stream_info(). Parameters already known to the demuxer are
+ * kept, the missing ones are taken from the layout.
+ *
+ * To also skip format probing, pass the input format recorded along with
+ * the layout to avformat_open_input().
+ *
+ * @param ic   media file handle, as returned by avformat_open_input()
+ * @param buf  layout data
+ * @param size size of buf
+ * @return 0 if the layout was applied, AVERROR_INVALIDDATA if it does not
+ *         match the input (avformat_find_stream_info() should be called
+ *         then), another negative AVERROR on failure
+ */
+int avformat_apply_stream_layout(AVFormatContext *ic,
+                                 const uint8_t *buf, int size);
+
 /**
  * Find the "best" stream in the file.
  * The best stream is determined according to various heuristics as the most
@@ -0,0 +1,124 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+
+#include "avformat.h"
+
+static int print_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    printf("    out %d dts %"PRId64"\n", pkt->stream_index, pkt->dts);
+    return 0;
+}
+
+static AVOutputFormat print_muxer = {
+    .name         = "print",
+    .long_name    = "print the packets in muxing order",
+    .audio_codec  = AV_CODEC_ID_PCM_S16LE,
+    .video_codec  = AV_CODEC_ID_RAWVIDEO,
+    .write_packet = print_packet,
+    .flags        = AVFMT_NOFILE | AVFMT_NOTIMESTAMPS,
+};
+
+typedef struct TestPacket {
+    int stream_index;
+    int64_t dts;
+} TestPacket;
+
+static int test(const char *name, const TestPacket *pkts, int nb_pkts,
+                int64_t max_interleave_delta, int max_interleave_packets)
+{
+    AVFormatContext *oc = avformat_alloc_context();
+    uint8_t data[16] = { 0 };
+    int i, ret;
+
+    printf("%s\n", name);
+    if (!oc)
+        return AVERROR(ENOMEM);
+    oc->oformat                = &print_muxer;
+    oc->max_interleave_delta   = max_interleave_delta;
+    oc->max_interleave_packets = max_interleave_packets;
+
+    for (i = 0; i < 2; i++) {
+        AVStream *st = avformat_new_stream(oc, NULL);
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        st->codec->codec_type = i ? AVMEDIA_TYPE_AUDIO : AVMEDIA_TYPE_VIDEO;
+        st->codec->codec_id   = i ? AV_CODEC_ID_PCM_S16LE :
+                                    AV_CODEC_ID_RAWVIDEO;
+        st->codec->width      = 16;
+        st->codec->height     = 16;
+        st->codec->pix_fmt    = AV_PIX_FMT_GRAY8;
+        st->codec->time_base  = (AVRational){ 1, 25 };
+        st->codec->sample_rate = 1000;
+        st->codec->channels   = 1;
+        st->codec->sample_fmt = AV_SAMPLE_FMT_S16;
+        st->time_base         = i ? (AVRational){ 1, 1000 } :
+                                    (AVRational){ 1, 25 };
+    }
+    if ((ret = avformat_write_header(oc, NULL)) < 0)
+        goto end;
+
+    for (i = 0; i < nb_pkts; i++) {
+        AVPacket pkt;
+
+        av_init_packet(&pkt);
+        pkt.data         = data;
+        pkt.size         = sizeof(data);
+        pkt.stream_index = pkts[i].stream_index;
+        pkt.pts = pkt.dts = pkts[i].dts;
+        pkt.flags        = AV_PKT_FLAG_KEY;
+        printf("in  %d dts %"PRId64"\n", pkt.stream_index, pkt.dts);
+        if ((ret = av_interleaved_write_frame(oc, &pkt)) < 0)
+            goto end;
+    }
+    printf("trailer\n");
+    ret = av_write_trailer(oc);
+
+end:
+    avformat_free_context(oc);
+    return ret;
+}
+
+int main(void)
+{
+    /* stream 0 is in 1/25 units, stream 1 in 1/1000 */
+    static const TestPacket mixed[] = {
+        { 0, 0 }, { 0, 1 }, { 1, 0 }, { 1, 60 }, { 0, 2 }, { 1, 80 },
+        { 0, 3 }, { 1, 100 }, { 1, 140 }, { 0, 4 },
+    };
+    /* stream 1 shows up only after 10 packets of stream 0 */
+    static const TestPacket sparse[] = {
+        { 0, 0 }, { 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 5 },
+        { 0, 6 }, { 0, 7 }, { 0, 8 }, { 0, 9 }, { 1, 200 }, { 0, 10 },
+        { 0, 11 },
+    };
+
+    av_register_all();
+
+    if (test("interleaved", mixed, FF_ARRAY_ELEMS(mixed), 0, 0) < 0 ||
+        test("sparse, no limit", sparse, FF_ARRAY_ELEMS(sparse), 0, 0) < 0 ||
+        test("sparse, max_interleave_delta 0.1s", sparse,
+             FF_ARRAY_ELEMS(sparse), 100000, 0) < 0 ||
+        test("sparse, max_interleave_packets 5", sparse,
+             FF_ARRAY_ELEMS(sparse), 0, 5) < 0)
+        return 1;
+    return 0;
+}
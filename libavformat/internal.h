@@ -48,6 +48,25 @@ struct AVFormatInternal {
      * Muxing only.
      */
     int nb_interleaved_streams;
+
+    /**
+     * Number of packets of each stream in the interleaving queue.
+     * Muxing only.
+     */
+    int *nb_queued_packets;
+
+    /**
+     * Number of streams with at least one packet in the interleaving queue.
+     * Muxing only.
+     */
+    int nb_queued_streams;
+
+    /**
+     * Unused packet list nodes, reused by the interleaving queue.
+     * Muxing only.
+     */
+    AVPacketList *packet_pool;
+    int nb_pooled_packets;
 };
 
 void ff_dynarray_add(intptr_t **tab_ptr, int *nb_ptr, intptr_t elem);
@@ -86,9 +105,32 @@ void ff_program_add_stream_index(AVFormatContext *ac, int progid, unsigned int i
 /**
  * Add packet to AVFormatContext->packet_buffer list, determining its
  * interleaved position using compare() function argument.
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
+                             int (*compare)(AVFormatContext *, AVPacket *, AVPacket *));
+
+/**
+ * Remove the first packet from AVFormatContext->packet_buffer and return it
+ * in out. The list must not be empty.
+ */
+void ff_interleave_pop_packet(AVFormatContext *s, AVPacket *out);
+
+/**
+ * Free all the packets following last in AVFormatContext->packet_buffer,
+ * or all of them if last is NULL.
+ */
+void ff_interleave_drop_packets(AVFormatContext *s, AVPacketList *last);
+
+/**
+ * @return the number of streams with packets in AVFormatContext->packet_buffer
+ */
+int ff_interleave_queued_streams(AVFormatContext *s);
+
+/**
+ * Free the interleaving queue bookkeeping of a muxing context.
  */
-void ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
-                              int (*compare)(AVFormatContext *, AVPacket *, AVPacket *));
+void ff_interleave_free(AVFormatContext *s);
 
 void ff_read_frame_flush(AVFormatContext *s);
 
@@ -0,0 +1,238 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "avformat.h"
+
+typedef struct Buffer {
+    uint8_t *data;
+    int size, pos;
+} Buffer;
+
+static int read_buffer(void *opaque, uint8_t *buf, int size)
+{
+    Buffer *b = opaque;
+
+    size = FFMIN(size, b->size - b->pos);
+    if (!size)
+        return AVERROR_EOF;
+    memcpy(buf, b->data + b->pos, size);
+    b->pos += size;
+    return size;
+}
+
+static int64_t seek_buffer(void *opaque, int64_t offset, int whence)
+{
+    Buffer *b = opaque;
+
+    switch (whence) {
+    case SEEK_SET: break;
+    case SEEK_CUR: offset += b->pos;  break;
+    case SEEK_END: offset += b->size; break;
+    case AVSEEK_SIZE: return b->size;
+    default: return AVERROR(EINVAL);
+    }
+    if (offset < 0 || offset > b->size)
+        return AVERROR(EINVAL);
+    b->pos = offset;
+    return offset;
+}
+
+/* Write a nut file with one PCM stream per entry of codec_ids. */
+static int write_file(Buffer *b, const enum AVCodecID *codec_ids,
+                      const int *sample_rates, int nb_streams)
+{
+    AVFormatContext *oc = avformat_alloc_context();
+    uint8_t data[256] = { 0 };
+    int i, j, ret;
+
+    if (!oc)
+        return AVERROR(ENOMEM);
+    oc->oformat = av_guess_format("nut", NULL, NULL);
+    if (!oc->oformat) {
+        ret = AVERROR_MUXER_NOT_FOUND;
+        goto end;
+    }
+    if ((ret = avio_open_dyn_buf(&oc->pb)) < 0)
+        goto end;
+
+    for (i = 0; i < nb_streams; i++) {
+        AVStream *st = avformat_new_stream(oc, NULL);
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        st->codec->codec_type  = AVMEDIA_TYPE_AUDIO;
+        st->codec->codec_id    = codec_ids[i];
+        st->codec->sample_rate = sample_rates[i];
+        st->codec->channels    = 1;
+        st->codec->sample_fmt  = codec_ids[i] == AV_CODEC_ID_PCM_U8 ?
+                                 AV_SAMPLE_FMT_U8 : AV_SAMPLE_FMT_S16;
+        st->codec->bits_per_coded_sample = 8 << (codec_ids[i] !=
+                                                 AV_CODEC_ID_PCM_U8);
+        st->time_base = (AVRational){ 1, sample_rates[i] };
+    }
+    if ((ret = avformat_write_header(oc, NULL)) < 0)
+        goto end;
+
+    for (j = 0; j < 16; j++) {
+        for (i = 0; i < nb_streams; i++) {
+            AVPacket pkt;
+
+            av_init_packet(&pkt);
+            pkt.data         = data;
+            pkt.size         = sizeof(data);
+            pkt.stream_index = i;
+            pkt.pts = pkt.dts = av_rescale(j, sample_rates[i], 100);
+            pkt.flags        = AV_PKT_FLAG_KEY;
+            if ((ret = av_interleaved_write_frame(oc, &pkt)) < 0)
+                goto end;
+        }
+    }
+    ret = av_write_trailer(oc);
+
+end:
+    if (oc->pb)
+        b->size = avio_close_dyn_buf(oc->pb, &b->data);
+    avformat_free_context(oc);
+    return ret;
+}
+
+static int open_file(AVFormatContext **ic, Buffer *b)
+{
+    uint8_t *io_buf;
+    int ret;
+
+    b->pos = 0;
+    if (!(*ic = avformat_alloc_context()) ||
+        !(io_buf = av_malloc(4096)))
+        return AVERROR(ENOMEM);
+    (*ic)->pb = avio_alloc_context(io_buf, 4096, 0, b, read_buffer, NULL,
+                                   seek_buffer);
+    if (!(*ic)->pb)
+        return AVERROR(ENOMEM);
+    if ((ret = avformat_open_input(ic, "", av_find_input_format("nut"),
+                                   NULL)) < 0)
+        return ret;
+    return 0;
+}
+
+static void close_file(AVFormatContext **ic)
+{
+    AVIOContext *pb = *ic ? (*ic)->pb : NULL;
+
+    avformat_close_input(ic);
+    if (pb)
+        av_free(pb->buffer);
+    av_free(pb);
+}
+
+static void print_streams(const char *name, AVFormatContext *ic)
+{
+    int i;
+
+    for (i = 0; i < ic->nb_streams; i++) {
+        AVCodecContext *enc = ic->streams[i]->codec;
+        printf("%s stream %d: %s %d Hz %d ch fmt %s frame_size %d "
+               "time_base %d/%d\n", name, i, avcodec_descriptor_get(enc->codec_id)->name,
+               enc->sample_rate, enc->channels,
+               av_get_sample_fmt_name(enc->sample_fmt) ?
+               av_get_sample_fmt_name(enc->sample_fmt) : "none",
+               enc->frame_size, enc->time_base.num, enc->time_base.den);
+    }
+}
+
+int main(void)
+{
+    static const enum AVCodecID ref_ids[2] = { AV_CODEC_ID_PCM_S16LE,
+                                               AV_CODEC_ID_PCM_S16LE };
+    static const enum AVCodecID alt_ids[2] = { AV_CODEC_ID_PCM_S16LE,
+                                               AV_CODEC_ID_PCM_U8 };
+    static const int rates[2] = { 44100, 48000 };
+    Buffer ref = { 0 }, alt = { 0 }, one = { 0 };
+    AVFormatContext *ic = NULL;
+    uint8_t *layout = NULL;
+    int size, ret;
+
+    av_register_all();
+    av_log_set_level(AV_LOG_QUIET);
+
+    if ((ret = write_file(&ref, ref_ids, rates, 2)) < 0 ||
+        (ret = write_file(&alt, alt_ids, rates, 2)) < 0 ||
+        (ret = write_file(&one, ref_ids, rates, 1)) < 0) {
+        fprintf(stderr, "Cannot write the test files\n");
+        return 1;
+    }
+
+    if ((ret = open_file(&ic, &ref)) < 0 ||
+        (ret = avformat_find_stream_info(ic, NULL)) < 0 ||
+        (ret = avformat_get_stream_layout(ic, &layout, &size)) < 0) {
+        fprintf(stderr, "Cannot probe the reference file\n");
+        return 1;
+    }
+    print_streams("probed", ic);
+    close_file(&ic);
+
+    if ((ret = open_file(&ic, &ref)) < 0)
+        return 1;
+    ret = avformat_apply_stream_layout(ic, layout, size);
+    printf("same layout: %s\n", ret < 0 ? "rejected" : "applied");
+    print_streams("applied", ic);
+    close_file(&ic);
+
+    /* A mismatch must leave every stream untouched, including the ones
+     * preceding the mismatching stream. */
+    if ((ret = open_file(&ic, &alt)) < 0)
+        return 1;
+    print_streams("opened", ic);
+    ret = avformat_apply_stream_layout(ic, layout, size);
+    printf("different codec: %s\n", ret == AVERROR_INVALIDDATA ? "rejected" :
+                                    ret < 0 ? "failed" : "applied");
+    print_streams("rejected", ic);
+    close_file(&ic);
+
+    if ((ret = open_file(&ic, &one)) < 0)
+        return 1;
+    ret = avformat_apply_stream_layout(ic, layout, size);
+    printf("different stream count: %s\n",
+           ret == AVERROR_INVALIDDATA ? "rejected" :
+           ret < 0 ? "failed" : "applied");
+    print_streams("rejected", ic);
+    close_file(&ic);
+
+    if ((ret = open_file(&ic, &ref)) < 0)
+        return 1;
+    /* extradata size of the last stream, pointing past the end */
+    AV_WB32(layout + size - 4, 1000);
+    ret = avformat_apply_stream_layout(ic, layout, size);
+    printf("truncated layout: %s\n", ret == AVERROR_INVALIDDATA ? "rejected" :
+                                     ret < 0 ? "failed" : "applied");
+    print_streams("rejected", ic);
+    close_file(&ic);
+
+    av_free(layout);
+    av_free(ref.data);
+    av_free(alt.data);
+    av_free(one.data);
+    return 0;
+}
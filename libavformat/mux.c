@@ -237,6 +237,13 @@ static int init_muxer(AVFormatContext *s, AVDictionary **options)
             s->internal->nb_interleaved_streams++;
     }
 
+    s->internal->nb_queued_packets = av_mallocz(s->nb_streams *
+                                                sizeof(*s->internal->nb_queued_packets));
+    if (s->nb_streams && !s->internal->nb_queued_packets) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
     if (!s->priv_data && of->priv_data_size > 0) {
         s->priv_data = av_mallocz(of->priv_data_size);
         if (!s->priv_data) {
@@ -477,12 +484,62 @@ int av_write_frame(AVFormatContext *s, AVPacket *pkt)
     return ret;
 }
 
-void ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
-                              int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
+/* Maximum number of unused packet list nodes kept for reuse. */
+#define MAX_POOLED_PACKETS 1024
+
+static AVPacketList *get_packet_node(AVFormatContext *s)
+{
+    AVFormatInternal *internal = s->internal;
+    AVPacketList *pktl         = internal->packet_pool;
+
+    if (!pktl)
+        return av_mallocz(sizeof(AVPacketList));
+
+    internal->packet_pool = pktl->next;
+    internal->nb_pooled_packets--;
+    memset(pktl, 0, sizeof(*pktl));
+    return pktl;
+}
+
+static void release_packet_node(AVFormatContext *s, AVPacketList *pktl)
+{
+    AVFormatInternal *internal = s->internal;
+
+    if (internal->nb_pooled_packets >= MAX_POOLED_PACKETS) {
+        av_free(pktl);
+        return;
+    }
+    pktl->next            = internal->packet_pool;
+    internal->packet_pool = pktl;
+    internal->nb_pooled_packets++;
+}
+
+static void packet_queued(AVFormatContext *s, int stream_index)
+{
+    AVFormatInternal *internal = s->internal;
+
+    if (!internal->nb_queued_packets[stream_index]++)
+        internal->nb_queued_streams++;
+}
+
+static void packet_dequeued(AVFormatContext *s, int stream_index)
+{
+    AVFormatInternal *internal = s->internal;
+
+    if (!--internal->nb_queued_packets[stream_index]) {
+        internal->nb_queued_streams--;
+        s->streams[stream_index]->last_in_packet_buffer = NULL;
+    }
+}
+
+int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
+                             int (*compare)(AVFormatContext *, AVPacket *, AVPacket *))
 {
     AVPacketList **next_point, *this_pktl;
 
-    this_pktl      = av_mallocz(sizeof(AVPacketList));
+    this_pktl = get_packet_node(s);
+    if (!this_pktl)
+        return AVERROR(ENOMEM);
     this_pktl->pkt = *pkt;
 #if FF_API_DESTRUCT_PACKET
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -515,6 +572,68 @@ next_non_null:
 
     s->streams[pkt->stream_index]->last_in_packet_buffer =
         *next_point                                      = this_pktl;
+    packet_queued(s, pkt->stream_index);
+    return 0;
+}
+
+void ff_interleave_pop_packet(AVFormatContext *s, AVPacket *out)
+{
+    AVPacketList *pktl = s->packet_buffer;
+
+    *out = pktl->pkt;
+
+    s->packet_buffer = pktl->next;
+    if (!s->packet_buffer)
+        s->packet_buffer_end = NULL;
+
+    packet_dequeued(s, out->stream_index);
+    release_packet_node(s, pktl);
+}
+
+void ff_interleave_drop_packets(AVFormatContext *s, AVPacketList *last)
+{
+    AVPacketList *pktl = last ? last->next : s->packet_buffer;
+
+    while (pktl) {
+        AVPacketList *next = pktl->next;
+
+        packet_dequeued(s, pktl->pkt.stream_index);
+        av_free_packet(&pktl->pkt);
+        release_packet_node(s, pktl);
+        pktl = next;
+    }
+
+    if (last) {
+        last->next           = NULL;
+        s->packet_buffer_end = last;
+        /* the last packet of some streams may have been dropped */
+        for (pktl = s->packet_buffer; pktl; pktl = pktl->next)
+            s->streams[pktl->pkt.stream_index]->last_in_packet_buffer = pktl;
+    } else {
+        s->packet_buffer     = NULL;
+        s->packet_buffer_end = NULL;
+    }
+}
+
+int ff_interleave_queued_streams(AVFormatContext *s)
+{
+    return s->internal->nb_queued_streams;
+}
+
+void ff_interleave_free(AVFormatContext *s)
+{
+    AVFormatInternal *internal = s->internal;
+
+    if (!internal)
+        return;
+
+    while (internal->packet_pool) {
+        AVPacketList *next = internal->packet_pool->next;
+        av_free(internal->packet_pool);
+        internal->packet_pool = next;
+    }
+    internal->nb_pooled_packets = 0;
+    av_freep(&internal->nb_queued_packets);
 }
 
 static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
@@ -533,15 +652,29 @@ static int interleave_compare_dts(AVFormatContext *s, AVPacket *next,
 int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                  AVPacket *pkt, int flush)
 {
-    AVPacketList *pktl;
-    int stream_count = 0;
-    int i;
+    AVFormatInternal *internal = s->internal;
+    int stream_count;
+    int i, ret;
 
     if (pkt) {
-        ff_interleave_add_packet(s, pkt, interleave_compare_dts);
+        if ((ret = ff_interleave_add_packet(s, pkt, interleave_compare_dts)) < 0)
+            return ret;
+
+        if (s->max_interleave_packets > 0 && !flush &&
+            internal->nb_queued_packets[pkt->stream_index] >
+            s->max_interleave_packets) {
+            av_log(s, AV_LOG_DEBUG,
+                   "%d packets queued for stream %d > %d: forcing output\n",
+                   internal->nb_queued_packets[pkt->stream_index],
+                   pkt->stream_index, s->max_interleave_packets);
+            flush = 1;
+        }
     }
 
-    if (s->max_interleave_delta > 0 && s->packet_buffer && !flush) {
+    stream_count = internal->nb_queued_streams;
+
+    if (s->max_interleave_delta > 0 && s->packet_buffer && !flush &&
+        stream_count < internal->nb_interleaved_streams) {
         AVPacket *top_pkt = &s->packet_buffer->pkt;
         int64_t delta_dts = INT64_MIN;
         int64_t top_dts = av_rescale_q(top_pkt->dts,
@@ -559,7 +692,6 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                                     s->streams[i]->time_base,
                                     AV_TIME_BASE_Q);
             delta_dts = FFMAX(delta_dts, last_dts - top_dts);
-            stream_count++;
         }
 
         if (delta_dts > s->max_interleave_delta) {
@@ -569,23 +701,10 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
                    delta_dts, s->max_interleave_delta);
             flush = 1;
         }
-    } else {
-        for (i = 0; i < s->nb_streams; i++)
-            stream_count += !!s->streams[i]->last_in_packet_buffer;
     }
 
-
-    if (stream_count && (s->internal->nb_interleaved_streams == stream_count || flush)) {
-        pktl = s->packet_buffer;
-        *out = pktl->pkt;
-
-        s->packet_buffer = pktl->next;
-        if (!s->packet_buffer)
-            s->packet_buffer_end = NULL;
-
-        if (s->streams[out->stream_index]->last_in_packet_buffer == pktl)
-            s->streams[out->stream_index]->last_in_packet_buffer = NULL;
-        av_freep(&pktl);
+    if (stream_count && (internal->nb_interleaved_streams == stream_count || flush)) {
+        ff_interleave_pop_packet(s, out);
         return 1;
     } else {
         av_init_packet(out);
@@ -1829,14 +1829,11 @@ static int mxf_write_footer(AVFormatContext *s)
 
 static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket *pkt, int flush)
 {
-    int i, stream_count = 0;
-
-    for (i = 0; i < s->nb_streams; i++)
-        stream_count += !!s->streams[i]->last_in_packet_buffer;
+    int stream_count = ff_interleave_queued_streams(s);
 
     if (stream_count && (s->nb_streams == stream_count || flush)) {
-        AVPacketList *pktl = s->packet_buffer;
         if (s->nb_streams != stream_count) {
+            AVPacketList *pktl = s->packet_buffer;
             AVPacketList *last = NULL;
             // find last packet in edit unit
             while (pktl) {
@@ -1847,33 +1844,13 @@ static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket
                 stream_count--;
             }
             // purge packet queue
-            while (pktl) {
-                AVPacketList *next = pktl->next;
-
-                if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl)
-                    s->streams[pktl->pkt.stream_index]->last_in_packet_buffer= NULL;
-                av_free_packet(&pktl->pkt);
-                av_freep(&pktl);
-                pktl = next;
-            }
-            if (last)
-                last->next = NULL;
-            else {
-                s->packet_buffer = NULL;
-                s->packet_buffer_end= NULL;
+            ff_interleave_drop_packets(s, last);
+            if (!last)
                 goto out;
-            }
-            pktl = s->packet_buffer;
         }
 
-        *out = pktl->pkt;
+        ff_interleave_pop_packet(s, out);
         av_dlog(s, "out st:%d dts:%"PRId64"\n", (*out).stream_index, (*out).dts);
-        s->packet_buffer = pktl->next;
-        if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl)
-            s->streams[pktl->pkt.stream_index]->last_in_packet_buffer= NULL;
-        if(!s->packet_buffer)
-            s->packet_buffer_end= NULL;
-        av_freep(&pktl);
         return 1;
     } else {
     out:
@@ -59,6 +59,7 @@ static const AVOption avformat_options[] = {
 {"buffer", "detect improper bitstream length", 0, AV_OPT_TYPE_CONST, {.i64 = AV_EF_BUFFER }, INT_MIN, INT_MAX, D, "err_detect"},
 {"explode", "abort decoding on minor error detection", 0, AV_OPT_TYPE_CONST, {.i64 = AV_EF_EXPLODE }, INT_MIN, INT_MAX, D, "err_detect"},
 {"max_interleave_delta", "maximum buffering duration for interleaving", OFFSET(max_interleave_delta), AV_OPT_TYPE_INT64, { .i64 = 10000000 }, 0, INT64_MAX, E },
+{"max_interleave_packets", "maximum number of packets buffered per stream for interleaving", OFFSET(max_interleave_packets), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, E },
 {NULL},
 };
 
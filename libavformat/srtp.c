@@ -38,19 +38,6 @@ void ff_srtp_free(struct SRTPContext *s)
     s->hmac = NULL;
 }
 
-static void encrypt_counter(struct AVAES *aes, uint8_t *iv, uint8_t *outbuf,
-                            int outlen)
-{
-    int i, j, outpos;
-    for (i = 0, outpos = 0; outpos < outlen; i++) {
-        uint8_t keystream[16];
-        AV_WB16(&iv[14], i);
-        av_aes_crypt(aes, keystream, iv, 1, NULL, 0);
-        for (j = 0; j < 16 && outpos < outlen; j++, outpos++)
-            outbuf[outpos] ^= keystream[j];
-    }
-}
-
 static void derive_key(struct AVAES *aes, const uint8_t *salt, int label,
                        uint8_t *out, int outlen)
 {
@@ -59,7 +46,7 @@ static void derive_key(struct AVAES *aes, const uint8_t *salt, int label,
     // Key derivation rate assumed to be zero
     input[14 - 7] ^= label;
     memset(out, 0, outlen);
-    encrypt_counter(aes, input, out, outlen);
+    av_aes_ctr_crypt(aes, out, out, outlen, input);
 }
 
 int ff_srtp_set_crypto(struct SRTPContext *s, const char *suite,
@@ -230,7 +217,7 @@ int ff_srtp_decrypt(struct SRTPContext *s, uint8_t *buf, int *lenptr)
 
     create_iv(iv, rtcp ? s->rtcp_salt : s->rtp_salt, index, ssrc);
     av_aes_init(s->aes, rtcp ? s->rtcp_key : s->rtp_key, 128, 0);
-    encrypt_counter(s->aes, iv, buf, len);
+    av_aes_ctr_crypt(s->aes, buf, buf, len, iv);
 
     return 0;
 }
@@ -303,7 +290,7 @@ int ff_srtp_encrypt(struct SRTPContext *s, const uint8_t *in, int len,
 
     create_iv(iv, rtcp ? s->rtcp_salt : s->rtp_salt, index, ssrc);
     av_aes_init(s->aes, rtcp ? s->rtcp_key : s->rtp_key, 128, 0);
-    encrypt_counter(s->aes, iv, buf, len);
+    av_aes_ctr_crypt(s->aes, buf, buf, len, iv);
 
     if (rtcp) {
         AV_WB32(buf + len, 0x80000000 | index);
@@ -2486,6 +2486,345 @@ find_stream_info_err:
     return ret;
 }
 
+#define STREAM_LAYOUT_TAG     MKBETAG('L', 'A', 'V', 'L')
+#define STREAM_LAYOUT_VERSION 1
+
+int avformat_get_stream_layout(AVFormatContext *ic, uint8_t **buf, int *size)
+{
+    AVIOContext *pb;
+    int i, ret;
+
+    *buf  = NULL;
+    *size = 0;
+
+    if (!ic->iformat)
+        return AVERROR(EINVAL);
+    if ((ret = avio_open_dyn_buf(&pb)) < 0)
+        return ret;
+
+    avio_wb32(pb, STREAM_LAYOUT_TAG);
+    avio_wb32(pb, STREAM_LAYOUT_VERSION);
+    avio_put_str(pb, ic->iformat->name);
+    avio_wb32(pb, ic->nb_streams);
+
+    for (i = 0; i < ic->nb_streams; i++) {
+        AVStream       *st  = ic->streams[i];
+        AVCodecContext *enc = st->codec;
+
+        avio_wb32(pb, st->id);
+        avio_wb32(pb, enc->codec_type);
+        avio_wb32(pb, enc->codec_id);
+        avio_wb32(pb, enc->codec_tag);
+        avio_wb32(pb, st->time_base.num);
+        avio_wb32(pb, st->time_base.den);
+        avio_wb32(pb, st->avg_frame_rate.num);
+        avio_wb32(pb, st->avg_frame_rate.den);
+        avio_wb32(pb, st->sample_aspect_ratio.num);
+        avio_wb32(pb, st->sample_aspect_ratio.den);
+        avio_wb32(pb, enc->time_base.num);
+        avio_wb32(pb, enc->time_base.den);
+        avio_wb32(pb, enc->sample_aspect_ratio.num);
+        avio_wb32(pb, enc->sample_aspect_ratio.den);
+        avio_wb32(pb, enc->width);
+        avio_wb32(pb, enc->height);
+        avio_wb32(pb, enc->pix_fmt);
+        avio_wb32(pb, enc->has_b_frames);
+        avio_wb32(pb, enc->sample_rate);
+        avio_wb32(pb, enc->channels);
+        avio_wb64(pb, enc->channel_layout);
+        avio_wb32(pb, enc->sample_fmt);
+        avio_wb32(pb, enc->frame_size);
+        avio_wb32(pb, enc->bits_per_coded_sample);
+        avio_wb32(pb, enc->profile);
+        avio_wb32(pb, enc->level);
+        avio_wb32(pb, enc->extradata_size);
+        if (enc->extradata_size)
+            avio_write(pb, enc->extradata, enc->extradata_size);
+    }
+
+    *size = avio_close_dyn_buf(pb, buf);
+    if (!*buf)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+typedef struct StreamLayout {
+    int id, codec_type, codec_id;
+    unsigned int codec_tag;
+    AVRational time_base, avg_frame_rate, sample_aspect_ratio;
+    AVRational codec_time_base, codec_sample_aspect_ratio;
+    int width, height, pix_fmt, has_b_frames;
+    int sample_rate, channels, sample_fmt, frame_size;
+    uint64_t channel_layout;
+    int bits_per_coded_sample, profile, level;
+    const uint8_t *extradata;
+    int extradata_size;
+} StreamLayout;
+
+static AVRational read_layout_q(GetByteContext *g)
+{
+    AVRational q;
+    q.num = bytestream2_get_be32(g);
+    q.den = bytestream2_get_be32(g);
+    return q;
+}
+
+static int read_stream_layout(GetByteContext *g, StreamLayout *l)
+{
+    l->id                        = bytestream2_get_be32(g);
+    l->codec_type                = bytestream2_get_be32(g);
+    l->codec_id                  = bytestream2_get_be32(g);
+    l->codec_tag                 = bytestream2_get_be32(g);
+    l->time_base                 = read_layout_q(g);
+    l->avg_frame_rate            = read_layout_q(g);
+    l->sample_aspect_ratio       = read_layout_q(g);
+    l->codec_time_base           = read_layout_q(g);
+    l->codec_sample_aspect_ratio = read_layout_q(g);
+    l->width                     = bytestream2_get_be32(g);
+    l->height                    = bytestream2_get_be32(g);
+    l->pix_fmt                   = bytestream2_get_be32(g);
+    l->has_b_frames              = bytestream2_get_be32(g);
+    l->sample_rate               = bytestream2_get_be32(g);
+    l->channels                  = bytestream2_get_be32(g);
+    l->channel_layout            = bytestream2_get_be64(g);
+    l->sample_fmt                = bytestream2_get_be32(g);
+    l->frame_size                = bytestream2_get_be32(g);
+    l->bits_per_coded_sample     = bytestream2_get_be32(g);
+    l->profile                   = bytestream2_get_be32(g);
+    l->level                     = bytestream2_get_be32(g);
+    l->extradata_size            = bytestream2_get_be32(g);
+    l->extradata                 = g->buffer;
+
+    if (l->extradata_size < 0 || l->extradata_size > FF_MAX_EXTRADATA_SIZE ||
+        l->extradata_size > bytestream2_get_bytes_left(g))
+        return AVERROR_INVALIDDATA;
+    bytestream2_skip(g, l->extradata_size);
+    return 0;
+}
+
+#define LAYOUT_SET(field, val)                  \
+    do {                                        \
+        if (!(field))                           \
+            (field) = val;                      \
+    } while (0)
+
+#define LAYOUT_SET_Q(field, val)                \
+    do {                                        \
+        if (!(field).num || !(field).den)       \
+            (field) = val;                      \
+    } while (0)
+
+/**
+ * Fill the parameters of st the demuxer did not set from the layout.
+ * extradata is set as the stream extradata if the stream has none, it is
+ * freed otherwise.
+ */
+static void apply_stream_layout(AVStream *st, const StreamLayout *l,
+                                uint8_t *extradata)
+{
+    AVCodecContext *enc = st->codec;
+
+    LAYOUT_SET(enc->codec_tag, l->codec_tag);
+    LAYOUT_SET_Q(st->time_base,            l->time_base);
+    LAYOUT_SET_Q(st->avg_frame_rate,       l->avg_frame_rate);
+    LAYOUT_SET_Q(st->sample_aspect_ratio,  l->sample_aspect_ratio);
+    LAYOUT_SET_Q(enc->time_base,           l->codec_time_base);
+    LAYOUT_SET_Q(enc->sample_aspect_ratio, l->codec_sample_aspect_ratio);
+    LAYOUT_SET(enc->width,  l->width);
+    LAYOUT_SET(enc->height, l->height);
+    if (enc->pix_fmt == AV_PIX_FMT_NONE && l->pix_fmt >= 0 &&
+        l->pix_fmt < AV_PIX_FMT_NB)
+        enc->pix_fmt = l->pix_fmt;
+    LAYOUT_SET(enc->has_b_frames,   l->has_b_frames);
+    LAYOUT_SET(enc->sample_rate,    l->sample_rate);
+    LAYOUT_SET(enc->channels,       l->channels);
+    LAYOUT_SET(enc->channel_layout, l->channel_layout);
+    if (enc->sample_fmt == AV_SAMPLE_FMT_NONE && l->sample_fmt >= 0 &&
+        l->sample_fmt < AV_SAMPLE_FMT_NB)
+        enc->sample_fmt = l->sample_fmt;
+    LAYOUT_SET(enc->frame_size,            l->frame_size);
+    LAYOUT_SET(enc->bits_per_coded_sample, l->bits_per_coded_sample);
+    if (enc->profile == FF_PROFILE_UNKNOWN)
+        enc->profile = l->profile;
+    if (enc->level == FF_LEVEL_UNKNOWN)
+        enc->level = l->level;
+
+    if (extradata && !enc->extradata) {
+        enc->extradata      = extradata;
+        enc->extradata_size = l->extradata_size;
+    } else {
+        av_free(extradata);
+    }
+}
+
+/* Per stream fields preceding the extradata, after id, type and codec id. */
+#define STREAM_LAYOUT_STREAM_SIZE (4 * 23 + 8)
+
+int avformat_apply_stream_layout(AVFormatContext *ic,
+                                 const uint8_t *buf, int size)
+{
+    GetByteContext g;
+    AVPacket pkt1, *pkt;
+    StreamLayout *layouts = NULL;
+    uint8_t **extradata   = NULL;
+    uint8_t *seen = NULL;
+    char name[128];
+    int i, nb_streams, nb_seen = 0, read_size = 0, ret = 0;
+    int64_t old_offset = avio_tell(ic->pb);
+
+    bytestream2_init(&g, buf, size);
+    if (bytestream2_get_be32(&g) != STREAM_LAYOUT_TAG ||
+        bytestream2_get_be32(&g) != STREAM_LAYOUT_VERSION)
+        return AVERROR_INVALIDDATA;
+
+    for (i = 0; i < sizeof(name) - 1; i++)
+        if (!(name[i] = bytestream2_get_byte(&g)))
+            break;
+    name[i] = 0;
+    if (strcmp(name, ic->iformat->name)) {
+        av_log(ic, AV_LOG_DEBUG, "Stream layout for format %s, input is %s\n",
+               name, ic->iformat->name);
+        return AVERROR_INVALIDDATA;
+    }
+
+    nb_streams = bytestream2_get_be32(&g);
+    if (nb_streams <= 0 ||
+        nb_streams > bytestream2_get_bytes_left(&g) /
+                     (STREAM_LAYOUT_STREAM_SIZE + 12))
+        return AVERROR_INVALIDDATA;
+
+    seen      = av_mallocz(nb_streams);
+    layouts   = av_malloc(nb_streams * sizeof(*layouts));
+    extradata = av_mallocz(nb_streams * sizeof(*extradata));
+    if (!seen || !layouts || !extradata) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (i = 0; i < nb_streams; i++)
+        if ((ret = read_stream_layout(&g, &layouts[i])) < 0)
+            goto fail;
+
+    /* Headerless formats may only create their streams once packets are
+     * read, so check the streams against the first packets: every stream of
+     * the layout has to show up before probesize bytes have been read. */
+    while (nb_seen < nb_streams) {
+        if (ff_check_interrupt(&ic->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            goto fail;
+        }
+        if (read_size >= ic->probesize) {
+            av_log(ic, AV_LOG_DEBUG,
+                   "Probe buffer size limit %d reached validating layout\n",
+                   ic->probesize);
+            ret = AVERROR_INVALIDDATA;
+            goto fail;
+        }
+
+        ret = read_frame_internal(ic, &pkt1);
+        if (ret == AVERROR(EAGAIN))
+            continue;
+        if (ret == AVERROR_EOF) {
+            av_log(ic, AV_LOG_DEBUG,
+                   "End of file reached before all streams were found\n");
+            ret = AVERROR_INVALIDDATA;
+        }
+        if (ret < 0)
+            goto fail;
+
+        if (ic->flags & AVFMT_FLAG_NOBUFFER) {
+            pkt = &pkt1;
+        } else {
+            pkt = add_to_pktbuf(&ic->packet_buffer, &pkt1,
+                                &ic->packet_buffer_end);
+            if (!pkt) {
+                av_free_packet(&pkt1);
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            if ((ret = av_dup_packet(pkt)) < 0)
+                goto fail;
+        }
+        read_size += pkt->size;
+
+        if (pkt->stream_index >= nb_streams) {
+            av_log(ic, AV_LOG_DEBUG,
+                   "Stream %d not present in layout\n", pkt->stream_index);
+            ret = AVERROR_INVALIDDATA;
+            goto fail;
+        }
+        if (!seen[pkt->stream_index]) {
+            seen[pkt->stream_index] = 1;
+            nb_seen++;
+        }
+        if (pkt == &pkt1)
+            av_free_packet(&pkt1);
+    }
+
+    if (ic->nb_streams != nb_streams) {
+        ret = AVERROR_INVALIDDATA;
+        goto fail;
+    }
+
+    /* Check every stream before touching any, so that a layout which does
+     * not match leaves the input as it was for avformat_find_stream_info(). */
+    for (i = 0; i < nb_streams; i++) {
+        AVStream *st = ic->streams[i];
+        const StreamLayout *l = &layouts[i];
+        AVCodecContext enc;
+        AVStream tmp;
+
+        if (st->id != l->id || st->codec->codec_type != l->codec_type ||
+            st->codec->codec_id != l->codec_id) {
+            av_log(ic, AV_LOG_DEBUG, "Stream %d does not match the layout\n",
+                   i);
+            ret = AVERROR_INVALIDDATA;
+            goto fail;
+        }
+
+        tmp       = *st;
+        enc       = *st->codec;
+        tmp.codec = &enc;
+        apply_stream_layout(&tmp, l, NULL);
+        if (!has_codec_parameters(&tmp)) {
+            av_log(ic, AV_LOG_DEBUG,
+                   "Stream layout incomplete for stream %d\n", i);
+            ret = AVERROR_INVALIDDATA;
+            goto fail;
+        }
+
+        if (l->extradata_size && !st->codec->extradata) {
+            extradata[i] = av_mallocz(l->extradata_size +
+                                      FF_INPUT_BUFFER_PADDING_SIZE);
+            if (!extradata[i]) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            memcpy(extradata[i], l->extradata, l->extradata_size);
+        }
+    }
+
+    for (i = 0; i < nb_streams; i++) {
+        apply_stream_layout(ic->streams[i], &layouts[i], extradata[i]);
+        extradata[i] = NULL;
+    }
+
+    estimate_timings(ic, old_offset);
+    compute_chapters_end(ic);
+
+    for (i = 0; i < ic->nb_streams; i++)
+        av_freep(&ic->streams[i]->info);
+
+fail:
+    if (extradata)
+        for (i = 0; i < nb_streams; i++)
+            av_free(extradata[i]);
+    av_free(extradata);
+    av_free(layouts);
+    av_free(seen);
+    return ret;
+}
+
 static AVProgram *find_program_from_stream(AVFormatContext *ic, int s)
 {
     int i, j;
@@ -2616,6 +2955,7 @@ void avformat_free_context(AVFormatContext *s)
     av_freep(&s->chapters);
     av_dict_free(&s->metadata);
     av_freep(&s->streams);
+    ff_interleave_free(s);
     av_freep(&s->internal);
     av_free(s);
 }
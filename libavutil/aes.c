@@ -22,24 +22,10 @@
 
 #include "common.h"
 #include "aes.h"
+#include "aes_internal.h"
 #include "intreadwrite.h"
 #include "timer.h"
 
-typedef union {
-    uint64_t u64[2];
-    uint32_t u32[4];
-    uint8_t u8x4[4][4];
-    uint8_t u8[16];
-} av_aes_block;
-
-typedef struct AVAES {
-    // Note: round_key[16] is accessed in the init code, but this only
-    // overwrites state, which does not matter (see also commit ba554c0).
-    av_aes_block round_key[15];
-    av_aes_block state[2];
-    int rounds;
-} AVAES;
-
 #if FF_API_CONTEXT_SIZE
 const int av_aes_size= sizeof(AVAES);
 #endif
@@ -130,43 +116,98 @@ static inline void mix(av_aes_block state[2], uint32_t multbl[][256], int s1, in
 }
 
 static inline void crypt(AVAES *a, int s, const uint8_t *sbox,
-                         uint32_t multbl[][256])
+                         uint32_t multbl[][256], const av_aes_block *round_key)
 {
     int r;
 
     for (r = a->rounds - 1; r > 0; r--) {
         mix(a->state, multbl, 3 - s, 1 + s);
-        addkey(&a->state[1], &a->state[0], &a->round_key[r]);
+        addkey(&a->state[1], &a->state[0], &round_key[r]);
     }
 
     subshift(&a->state[0], s, sbox);
 }
 
-void av_aes_crypt(AVAES *a, uint8_t *dst, const uint8_t *src,
-                  int count, uint8_t *iv, int decrypt)
+static void aes_encrypt(AVAES *a, uint8_t *dst, const uint8_t *src,
+                        int count, uint8_t *iv, int rounds)
 {
+    const av_aes_block *round_key = a->round_key[0];
+
     while (count--) {
-        addkey_s(&a->state[1], src, &a->round_key[a->rounds]);
-        if (decrypt) {
-            crypt(a, 0, inv_sbox, dec_multbl);
-            if (iv) {
-                addkey_s(&a->state[0], iv, &a->state[0]);
-                memcpy(iv, src, 16);
-            }
-            addkey_d(dst, &a->state[0], &a->round_key[0]);
-        } else {
-            if (iv)
-                addkey_s(&a->state[1], iv, &a->state[1]);
-            crypt(a, 2, sbox, enc_multbl);
-            addkey_d(dst, &a->state[0], &a->round_key[0]);
-            if (iv)
-                memcpy(iv, dst, 16);
+        addkey_s(&a->state[1], src, &round_key[rounds]);
+        if (iv)
+            addkey_s(&a->state[1], iv, &a->state[1]);
+        crypt(a, 2, sbox, enc_multbl, round_key);
+        addkey_d(dst, &a->state[0], &round_key[0]);
+        if (iv)
+            memcpy(iv, dst, 16);
+        src += 16;
+        dst += 16;
+    }
+}
+
+static void aes_decrypt(AVAES *a, uint8_t *dst, const uint8_t *src,
+                        int count, uint8_t *iv, int rounds)
+{
+    const av_aes_block *round_key = a->round_key[1];
+
+    while (count--) {
+        addkey_s(&a->state[1], src, &round_key[rounds]);
+        crypt(a, 0, inv_sbox, dec_multbl, round_key);
+        if (iv) {
+            addkey_s(&a->state[0], iv, &a->state[0]);
+            memcpy(iv, src, 16);
         }
+        addkey_d(dst, &a->state[0], &round_key[0]);
         src += 16;
         dst += 16;
     }
 }
 
+void av_aes_crypt(AVAES *a, uint8_t *dst, const uint8_t *src,
+                  int count, uint8_t *iv, int decrypt)
+{
+    a->crypt[!!decrypt](a, dst, src, count, iv, a->rounds);
+}
+
+static void increment_counter(uint8_t *ctr)
+{
+    int i;
+
+    for (i = 15; i >= 0; i--)
+        if (++ctr[i])
+            break;
+}
+
+void av_aes_ctr_crypt(AVAES *a, uint8_t *dst, const uint8_t *src,
+                      int size, uint8_t *iv)
+{
+    DECLARE_ALIGNED(16, uint8_t, counter)[16 * 8];
+    DECLARE_ALIGNED(16, uint8_t, keystream)[16 * 8];
+
+    while (size > 0) {
+        int blocks = FFMIN((size + 15) >> 4, 8);
+        int len    = FFMIN(size, 16 * blocks);
+        int i;
+
+        /* generate the keystream for several blocks with a single call */
+        for (i = 0; i < blocks; i++) {
+            memcpy(counter + 16 * i, iv, 16);
+            increment_counter(iv);
+        }
+        a->crypt[0](a, keystream, counter, blocks, NULL, a->rounds);
+
+        for (i = 0; i + 8 <= len; i += 8)
+            AV_WN64(dst + i, AV_RN64(src + i) ^ AV_RN64(keystream + i));
+        for (; i < len; i++)
+            dst[i] = src[i] ^ keystream[i];
+
+        src  += len;
+        dst  += len;
+        size -= len;
+    }
+}
+
 static void init_multbl2(uint32_t tbl[][256], const int c[4],
                          const uint8_t *log8, const uint8_t *alog8,
                          const uint8_t *sbox)
@@ -227,10 +268,15 @@ int av_aes_init(AVAES *a, const uint8_t *key, int key_bits, int decrypt)
     if (key_bits != 128 && key_bits != 192 && key_bits != 256)
         return -1;
 
-    a->rounds = rounds;
+    a->rounds   = rounds;
+    a->crypt[0] = aes_encrypt;
+    a->crypt[1] = aes_decrypt;
+
+    if (ARCH_X86)
+        ff_init_aes_x86(a);
 
     memcpy(tk, key, KC * 4);
-    memcpy(a->round_key[0].u8, key, KC * 4);
+    memcpy(a->round_key[1][0].u8, key, KC * 4);
 
     for (t = KC * 4; t < (rounds + 1) * 16; t += KC * 4) {
         for (i = 0; i < 4; i++)
@@ -246,21 +292,18 @@ int av_aes_init(AVAES *a, const uint8_t *key, int key_bits, int decrypt)
                     tk[j][i] ^= sbox[tk[j - 1][i]];
         }
 
-        memcpy(a->round_key[0].u8 + t, tk, KC * 4);
+        memcpy(a->round_key[1][0].u8 + t, tk, KC * 4);
     }
 
-    if (decrypt) {
-        for (i = 1; i < rounds; i++) {
-            av_aes_block tmp[3];
-            tmp[2] = a->round_key[i];
-            subshift(&tmp[1], 0, sbox);
-            mix(tmp, dec_multbl, 1, 3);
-            a->round_key[i] = tmp[0];
-        }
-    } else {
-        for (i = 0; i < (rounds + 1) >> 1; i++) {
-            FFSWAP(av_aes_block, a->round_key[i], a->round_key[rounds-i]);
-        }
+    for (i = 0; i <= rounds; i++)
+        a->round_key[0][i] = a->round_key[1][rounds - i];
+
+    for (i = 1; i < rounds; i++) {
+        av_aes_block tmp[3];
+        tmp[2] = a->round_key[1][i];
+        subshift(&tmp[1], 0, sbox);
+        mix(tmp, dec_multbl, 1, 3);
+        a->round_key[1][i] = tmp[0];
     }
 
     return 0;
@@ -268,9 +311,146 @@ int av_aes_init(AVAES *a, const uint8_t *key, int key_bits, int decrypt)
 
 #ifdef TEST
 #include <string.h>
+#include "cpu.h"
 #include "lfg.h"
 #include "log.h"
 
+/* NIST SP 800-38A F.1.1, F.2.5 and F.5.1, with the four plaintext blocks
+ * followed by blocks 3, 2 and 1 again */
+static const uint8_t kat_key128[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+static const uint8_t kat_key256[32] = {
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe,
+    0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+    0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7,
+    0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+};
+static const uint8_t kat_iv[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+static const uint8_t kat_counter[16] = {
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+    0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+static const uint8_t kat_pt[7 * 16] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+    0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+    0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+    0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+    0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+    0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a
+};
+static const uint8_t kat_ecb128[7 * 16] = {
+    0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+    0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97,
+    0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d,
+    0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf,
+    0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23,
+    0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88,
+    0x7b, 0x0c, 0x78, 0x5e, 0x27, 0xe8, 0xad, 0x3f,
+    0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5d, 0xd4,
+    0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23,
+    0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88,
+    0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d,
+    0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf,
+    0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60,
+    0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97
+};
+static const uint8_t kat_cbc256[7 * 16] = {
+    0xf5, 0x8c, 0x4c, 0x04, 0xd6, 0xe5, 0xf1, 0xba,
+    0x77, 0x9e, 0xab, 0xfb, 0x5f, 0x7b, 0xfb, 0xd6,
+    0x9c, 0xfc, 0x4e, 0x96, 0x7e, 0xdb, 0x80, 0x8d,
+    0x67, 0x9f, 0x77, 0x7b, 0xc6, 0x70, 0x2c, 0x7d,
+    0x39, 0xf2, 0x33, 0x69, 0xa9, 0xd9, 0xba, 0xcf,
+    0xa5, 0x30, 0xe2, 0x63, 0x04, 0x23, 0x14, 0x61,
+    0xb2, 0xeb, 0x05, 0xe2, 0xc3, 0x9b, 0xe9, 0xfc,
+    0xda, 0x6c, 0x19, 0x07, 0x8c, 0x6a, 0x9d, 0x1b,
+    0x91, 0x77, 0x46, 0xb2, 0xc8, 0x36, 0x19, 0x70,
+    0x22, 0xc4, 0x92, 0x95, 0xe0, 0x42, 0x77, 0xf9,
+    0xfe, 0xa6, 0x05, 0x14, 0x86, 0xef, 0xb7, 0x0a,
+    0xe8, 0xef, 0x96, 0xcb, 0x41, 0xc1, 0xd1, 0xc3,
+    0xee, 0xb1, 0xfa, 0x4e, 0xfc, 0x0d, 0x4d, 0xc9,
+    0x82, 0x8c, 0xd4, 0xe8, 0x35, 0x74, 0xf5, 0xb9
+};
+static const uint8_t kat_ctr128[60] = {
+    0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+    0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+    0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+    0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+    0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+    0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+    0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+    0x79, 0x21, 0x70, 0xa0
+};
+
+static int check(const char *name, int blocks, const uint8_t *out,
+                 const uint8_t *ref, int size)
+{
+    if (memcmp(out, ref, size)) {
+        av_log(NULL, AV_LOG_ERROR, "%s, %d blocks: mismatch\n", name, blocks);
+        return 1;
+    }
+    return 0;
+}
+
+/* Multi-block known answers. The block counts are not multiples of 4, so
+ * that implementations working on several blocks at once also run their
+ * tail code, and the contexts are set up for the other direction. */
+static int test_kat(void)
+{
+    AVAES ecb, cbc, ctr;
+    uint8_t buf[7 * 16], iv[16];
+    int n, err = 0;
+
+    av_aes_init(&ecb, kat_key128, 128, 1);
+    av_aes_init(&cbc, kat_key256, 256, 0);
+    av_aes_init(&ctr, kat_key128, 128, 1);
+
+    for (n = 1; n <= 7; n += 2) {
+        av_aes_crypt(&ecb, buf, kat_pt, n, NULL, 0);
+        err |= check("ECB encrypt", n, buf, kat_ecb128, 16 * n);
+        av_aes_crypt(&ecb, buf, buf, n, NULL, 1);
+        err |= check("ECB decrypt in place", n, buf, kat_pt, 16 * n);
+
+        memcpy(iv, kat_iv, 16);
+        av_aes_crypt(&cbc, buf, kat_pt, n, iv, 0);
+        err |= check("CBC encrypt", n, buf, kat_cbc256, 16 * n);
+        err |= check("CBC encrypt iv", n, iv, kat_cbc256 + 16 * (n - 1), 16);
+
+        memcpy(iv, kat_iv, 16);
+        av_aes_crypt(&cbc, buf, kat_cbc256, n, iv, 1);
+        err |= check("CBC decrypt", n, buf, kat_pt, 16 * n);
+        err |= check("CBC decrypt iv", n, iv, kat_cbc256 + 16 * (n - 1), 16);
+
+        memcpy(iv, kat_iv, 16);
+        memcpy(buf, kat_cbc256, 16 * n);
+        av_aes_crypt(&cbc, buf, buf, n, iv, 1);
+        err |= check("CBC decrypt in place", n, buf, kat_pt, 16 * n);
+    }
+
+    /* a partial last block, in one call and split after two blocks */
+    memcpy(iv, kat_counter, 16);
+    av_aes_ctr_crypt(&ctr, buf, kat_pt, 60, iv);
+    err |= check("CTR", 4, buf, kat_ctr128, 60);
+    memcpy(iv, kat_counter, 16);
+    av_aes_ctr_crypt(&ctr, buf, kat_ctr128, 32, iv);
+    av_aes_ctr_crypt(&ctr, buf + 32, kat_ctr128 + 32, 28, iv);
+    err |= check("CTR split", 4, buf, kat_pt, 60);
+
+    return err;
+}
+
 int main(int argc, char **argv)
 {
     int i, j;
@@ -308,6 +488,12 @@ int main(int argc, char **argv)
         }
     }
 
+    /* with the optimized code, if any, and with the C code */
+    err |= test_kat();
+    av_set_cpu_flags_mask(0);
+    err |= test_kat();
+    av_set_cpu_flags_mask(-1);
+
     if (argc > 1 && !strcmp(argv[1], "-t")) {
         AVAES ae, ad;
         AVLFG prng;
@@ -45,8 +45,10 @@ struct AVAES *av_aes_alloc(void);
 
 /**
  * Initialize an AVAES context.
+ * The context can be used for both encryption and decryption.
  * @param key_bits 128, 192 or 256
- * @param decrypt 0 for encryption, 1 for decryption
+ * @param decrypt 0 for encryption, 1 for decryption, ignored since both
+ *                directions are set up
  */
 int av_aes_init(struct AVAES *a, const uint8_t *key, int key_bits, int decrypt);
 
@@ -60,6 +62,23 @@ int av_aes_init(struct AVAES *a, const uint8_t *key, int key_bits, int decrypt);
  */
 void av_aes_crypt(struct AVAES *a, uint8_t *dst, const uint8_t *src, int count, uint8_t *iv, int decrypt);
 
+/**
+ * Encrypt or decrypt a buffer in counter (CTR) mode.
+ *
+ * The keystream is generated by encrypting successive values of a 128-bit
+ * big-endian counter, so encryption and decryption are the same operation.
+ * The keystream of a final partial block is discarded,
+ * so when a stream is processed in several calls, all but the last one must
+ * use a multiple of 16 bytes.
+ *
+ * @param size number of bytes to process
+ * @param dst destination array, can be equal to src
+ * @param src source array, can be equal to dst
+ * @param iv 16 byte initial counter block, updated to the next unused
+ *           counter value
+ */
+void av_aes_ctr_crypt(struct AVAES *a, uint8_t *dst, const uint8_t *src, int size, uint8_t *iv);
+
 /**
  * @}
  */
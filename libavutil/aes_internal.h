@@ -0,0 +1,52 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_AES_INTERNAL_H
+#define AVUTIL_AES_INTERNAL_H
+
+#include <stdint.h>
+
+#include "mem.h"
+
+typedef union {
+    uint64_t u64[2];
+    uint32_t u32[4];
+    uint8_t u8x4[4][4];
+    uint8_t u8[16];
+} av_aes_block;
+
+typedef struct AVAES {
+    // Note: round_key[1][16] is accessed in the init code, but this only
+    // overwrites state, which does not matter (see also commit ba554c0).
+    // round_key[0] holds the encryption and round_key[1] the decryption
+    // round keys, so that a context works in both directions. They are
+    // stored in the order in which they are applied, starting from
+    // round_key[][rounds] down to round_key[][0], and use the equivalent
+    // inverse cipher layout for decryption, so they can be used directly
+    // by the AES-NI instructions.
+    DECLARE_ALIGNED(16, av_aes_block, round_key)[2][15];
+    DECLARE_ALIGNED(16, av_aes_block, state)[2];
+    int rounds;
+    /* crypt[0] encrypts, crypt[1] decrypts */
+    void (*crypt[2])(struct AVAES *a, uint8_t *dst, const uint8_t *src,
+                     int count, uint8_t *iv, int rounds);
+} AVAES;
+
+void ff_init_aes_x86(AVAES *a);
+
+#endif /* AVUTIL_AES_INTERNAL_H */
@@ -199,6 +199,11 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     if (!pool)
         return NULL;
 
+    if (ff_mutex_init(&pool->pop_mutex, NULL)) {
+        av_free(pool);
+        return NULL;
+    }
+
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
@@ -207,6 +212,13 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     return pool;
 }
 
+static void pool_free_entry(BufferPoolEntry *buf)
+{
+    avpriv_atomic_int_add_and_fetch(&buf->pool->nb_buffers, -1);
+    buf->free(buf->opaque, buf->data);
+    av_free(buf);
+}
+
 /*
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
@@ -217,9 +229,9 @@ static void buffer_pool_free(AVBufferPool *pool)
         BufferPoolEntry *buf = pool->pool;
         pool->pool = buf->next;
 
-        buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
+        pool_free_entry(buf);
     }
+    ff_mutex_destroy(&pool->pop_mutex);
     av_freep(&pool);
 }
 
@@ -236,47 +248,45 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
-/* remove the whole buffer list from the pool and return it */
-static BufferPoolEntry *get_pool(AVBufferPool *pool)
+/* remove the first buffer from the pool, must be called with pop_mutex held */
+static BufferPoolEntry *get_from_pool(AVBufferPool *pool)
 {
-    BufferPoolEntry *cur = NULL, *last = NULL;
+    BufferPoolEntry *cur;
 
     do {
-        FFSWAP(BufferPoolEntry*, cur, last);
-        cur = avpriv_atomic_ptr_cas((void * volatile *)&pool->pool, last, NULL);
+        cur = pool->pool;
         if (!cur)
             return NULL;
-    } while (cur != last);
+    } while (avpriv_atomic_ptr_cas((void * volatile *)&pool->pool,
+                                   cur, cur->next) != cur);
+    avpriv_atomic_int_add_and_fetch(&pool->nb_idle, -1);
 
     return cur;
 }
 
 static void add_to_pool(BufferPoolEntry *buf)
 {
-    AVBufferPool *pool;
-    BufferPoolEntry *cur, *end = buf;
-
-    if (!buf)
-        return;
-    pool = buf->pool;
-
-    while (end->next)
-        end = end->next;
+    AVBufferPool *pool = buf->pool;
+    BufferPoolEntry *cur;
 
-    while ((cur = avpriv_atomic_ptr_cas((void * volatile *)&pool->pool, NULL, buf))) {
-        /* pool is not empty, retrieve it and append it to our list */
-        cur = get_pool(pool);
-        end->next = cur;
-        while (end->next)
-            end = end->next;
-    }
+    avpriv_atomic_int_add_and_fetch(&pool->nb_idle, 1);
+    do {
+        cur       = pool->pool;
+        buf->next = cur;
+    } while (avpriv_atomic_ptr_cas((void * volatile *)&pool->pool,
+                                   cur, buf) != cur);
 }
 
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
     AVBufferPool *pool = buf->pool;
-    add_to_pool(buf);
+    int max_idle = avpriv_atomic_int_get(&pool->max_idle);
+
+    if (max_idle && avpriv_atomic_int_get(&pool->nb_idle) >= max_idle)
+        pool_free_entry(buf);
+    else
+        add_to_pool(buf);
     if (!avpriv_atomic_int_add_and_fetch(&pool->refcount, -1))
         buffer_pool_free(pool);
 }
@@ -307,6 +317,7 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
     ret->buffer->free   = pool_release_buffer;
 
     avpriv_atomic_int_add_and_fetch(&pool->refcount, 1);
+    avpriv_atomic_int_add_and_fetch(&pool->nb_buffers, 1);
 
     return ret;
 }
@@ -316,13 +327,13 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
-    /* check whether the pool is empty */
-    buf = get_pool(pool);
-    if (!buf)
+    ff_mutex_lock(&pool->pop_mutex);
+    buf = get_from_pool(pool);
+    ff_mutex_unlock(&pool->pop_mutex);
+    if (!buf) {
+        avpriv_atomic_int_add_and_fetch(&pool->nb_misses, 1);
         return pool_alloc_buffer(pool);
-
-    /* keep the first entry, return the rest of the list to the pool */
-    add_to_pool(buf->next);
+    }
     buf->next = NULL;
 
     ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
@@ -332,6 +343,137 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
         return NULL;
     }
     avpriv_atomic_int_add_and_fetch(&pool->refcount, 1);
+    avpriv_atomic_int_add_and_fetch(&pool->nb_hits, 1);
 
     return ret;
 }
+
+void av_buffer_pool_trim(AVBufferPool *pool, int nb_idle)
+{
+    BufferPoolEntry *buf, *list = NULL;
+
+    /* only unlink under the lock, freeing may take long */
+    ff_mutex_lock(&pool->pop_mutex);
+    while (avpriv_atomic_int_get(&pool->nb_idle) > nb_idle &&
+           (buf = get_from_pool(pool))) {
+        buf->next = list;
+        list      = buf;
+    }
+    ff_mutex_unlock(&pool->pop_mutex);
+
+    while (list) {
+        buf  = list;
+        list = buf->next;
+        pool_free_entry(buf);
+    }
+}
+
+void av_buffer_pool_set_max_idle(AVBufferPool *pool, int max_idle)
+{
+    avpriv_atomic_int_set(&pool->max_idle, max_idle);
+    if (max_idle)
+        av_buffer_pool_trim(pool, max_idle);
+}
+
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats)
+{
+    stats->hits       = avpriv_atomic_int_get(&pool->nb_hits);
+    stats->misses     = avpriv_atomic_int_get(&pool->nb_misses);
+    stats->nb_buffers = avpriv_atomic_int_get(&pool->nb_buffers);
+    stats->nb_idle    = avpriv_atomic_int_get(&pool->nb_idle);
+    stats->bytes_held = (int64_t)stats->nb_buffers * pool->size;
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+
+#define NB_THREADS 4
+
+static void *pool_thread(void *arg)
+{
+    AVBufferPool *pool = arg;
+    AVBufferRef *bufs[8] = { NULL };
+    int i;
+
+    for (i = 0; i < 20000; i++) {
+        int j = i & 7;
+        if (bufs[j])
+            av_buffer_unref(&bufs[j]);
+        else if (!(bufs[j] = av_buffer_pool_get(pool)))
+            return NULL;
+        if (i % 1000 == 999)
+            av_buffer_pool_trim(pool, 2);
+    }
+    for (i = 0; i < 8; i++)
+        av_buffer_unref(&bufs[i]);
+    return NULL;
+}
+#endif
+
+static void print_stats(AVBufferPool *pool)
+{
+    AVBufferPoolStats stats;
+
+    av_buffer_pool_get_stats(pool, &stats);
+    printf("hits %u misses %u buffers %d idle %d bytes %"PRId64"\n",
+           stats.hits, stats.misses, stats.nb_buffers, stats.nb_idle,
+           stats.bytes_held);
+}
+
+int main(void)
+{
+    AVBufferPool *pool = av_buffer_pool_init(1024, NULL);
+    AVBufferRef *bufs[4];
+    AVBufferPoolStats stats;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        bufs[i] = av_buffer_pool_get(pool);
+    print_stats(pool);
+
+    for (i = 0; i < 4; i++)
+        av_buffer_unref(&bufs[i]);
+    print_stats(pool);
+
+    for (i = 0; i < 2; i++)
+        bufs[i] = av_buffer_pool_get(pool);
+    print_stats(pool);
+
+    av_buffer_pool_trim(pool, 1);
+    print_stats(pool);
+
+    av_buffer_pool_set_max_idle(pool, 1);
+    for (i = 0; i < 2; i++)
+        av_buffer_unref(&bufs[i]);
+    print_stats(pool);
+
+    av_buffer_pool_set_max_idle(pool, 0);
+    av_buffer_pool_trim(pool, 0);
+    print_stats(pool);
+
+#if HAVE_PTHREADS
+    {
+        pthread_t threads[NB_THREADS];
+
+        for (i = 0; i < NB_THREADS; i++)
+            pthread_create(&threads[i], NULL, pool_thread, pool);
+        for (i = 0; i < NB_THREADS; i++)
+            pthread_join(threads[i], NULL);
+    }
+#endif
+    av_buffer_pool_get_stats(pool, &stats);
+    if (stats.nb_buffers != stats.nb_idle) {
+        printf("%d buffers allocated, %d idle\n",
+               stats.nb_buffers, stats.nb_idle);
+        return 1;
+    }
+
+    av_buffer_pool_uninit(&pool);
+    return 0;
+}
+
+#endif /* TEST */
@@ -199,7 +199,9 @@ int av_buffer_realloc(AVBufferRef **buf, int size);
  * @ingroup lavu_data
  *
  * @{
- * AVBufferPool is an API for a lock-free thread-safe pool of AVBuffers.
+ * AVBufferPool is an API for a thread-safe pool of AVBuffers. Buffers are
+ * returned to the pool without locking, only taking a buffer from the pool
+ * briefly excludes other threads doing the same.
  *
  * Frequently allocating and freeing large buffers may be slow. AVBufferPool is
  * meant to solve this in cases when the caller needs a set of buffers of the
@@ -260,6 +262,45 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Free unused buffers held by the pool, so that at most nb_idle of them
+ * remain. This function may be called simultaneously from multiple threads.
+ */
+void av_buffer_pool_trim(AVBufferPool *pool, int nb_idle);
+
+/**
+ * Limit the number of unused buffers held by the pool. Buffers released
+ * while the pool already holds max_idle unused buffers are freed instead of
+ * being returned to it, and the unused buffers above the limit are freed
+ * immediately.
+ *
+ * @param max_idle maximum number of unused buffers, 0 (the default) for no
+ *                 limit
+ */
+void av_buffer_pool_set_max_idle(AVBufferPool *pool, int max_idle);
+
+/**
+ * Statistics of a buffer pool, see av_buffer_pool_get_stats().
+ */
+typedef struct AVBufferPoolStats {
+    /**
+     * Number of av_buffer_pool_get() calls that reused an unused buffer,
+     * respectively allocated a new one. These counters wrap around.
+     */
+    unsigned hits;
+    unsigned misses;
+
+    int nb_buffers;     ///< number of buffers allocated by the pool, in use or not
+    int nb_idle;        ///< number of unused buffers held by the pool
+    int64_t bytes_held; ///< size of all the buffers allocated by the pool
+} AVBufferPoolStats;
+
+/**
+ * Get the current statistics of the pool. The values are only approximate
+ * while other threads use the pool.
+ */
+void av_buffer_pool_get_stats(AVBufferPool *pool, AVBufferPoolStats *stats);
+
 /**
  * @}
  */
@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include "buffer.h"
+#include "thread.h"
 
 /**
  * The buffer is always treated as read-only.
@@ -72,7 +73,14 @@ typedef struct BufferPoolEntry {
 } BufferPoolEntry;
 
 struct AVBufferPool {
+    /*
+     * Stack of the unused buffers. Any thread may push a released buffer
+     * onto it without locking, but only the thread holding pop_mutex may pop
+     * from it, so that the head cannot be popped and pushed back while
+     * another pop is in progress.
+     */
     BufferPoolEntry * volatile pool;
+    AVMutex pop_mutex;
 
     /*
      * This is used to track when the pool is to be freed.
@@ -85,6 +93,12 @@ struct AVBufferPool {
      */
     volatile int refcount;
 
+    volatile int max_idle;
+    volatile int nb_idle;       ///< number of buffers in pool
+    volatile int nb_buffers;    ///< number of allocated buffers, in use or idle
+    volatile int nb_hits;
+    volatile int nb_misses;
+
     int size;
     AVBufferRef* (*alloc)(int size);
 };
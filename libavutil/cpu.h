@@ -52,6 +52,8 @@
 #define AV_CPU_FLAG_FMA3        0x10000 ///< Haswell FMA3 functions
 #define AV_CPU_FLAG_BMI1        0x20000 ///< Bit Manipulation Instruction Set 1
 #define AV_CPU_FLAG_BMI2        0x40000 ///< Bit Manipulation Instruction Set 2
+#define AV_CPU_FLAG_AESNI       0x80000 ///< Advanced Encryption Standard functions
+#define AV_CPU_FLAG_PCLMUL     0x100000 ///< carry-less multiplication (PCLMULQDQ)
 
 #define AV_CPU_FLAG_ALTIVEC      0x0001 ///< standard
 
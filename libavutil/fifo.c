@@ -19,22 +19,52 @@
  * License along with Libav; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include "atomic.h"
 #include "common.h"
 #include "fifo.h"
 
-AVFifoBuffer *av_fifo_alloc(unsigned int size)
+/* In SPSC mode, the read and write indices are the only state shared
+ * between the two threads, the pointers are private to their side. The
+ * indices go through full barriers: a side publishes its index only after
+ * its accesses to the data, and accesses the data only after loading the
+ * index of the other side. */
+static inline uint32_t load_index(const AVFifoBuffer *f, uint32_t *idx)
+{
+    if (f->flags & AV_FIFO_FLAG_SPSC)
+        return avpriv_atomic_int_add_and_fetch((volatile int *)idx, 0);
+    return *idx;
+}
+
+static inline void store_index(const AVFifoBuffer *f, uint32_t *idx,
+                               uint32_t val)
+{
+    /* only this side writes idx, so it can be read without a barrier */
+    if (f->flags & AV_FIFO_FLAG_SPSC)
+        avpriv_atomic_int_add_and_fetch((volatile int *)idx,
+                                        (int)(val - *idx));
+    else
+        *idx = val;
+}
+
+AVFifoBuffer *av_fifo_alloc2(unsigned int size, int flags)
 {
     AVFifoBuffer *f = av_mallocz(sizeof(AVFifoBuffer));
     if (!f)
         return NULL;
     f->buffer = av_malloc(size);
     f->end    = f->buffer + size;
+    f->flags  = flags;
     av_fifo_reset(f);
     if (!f->buffer)
         av_freep(&f);
     return f;
 }
 
+AVFifoBuffer *av_fifo_alloc(unsigned int size)
+{
+    return av_fifo_alloc2(size, 0);
+}
+
 void av_fifo_free(AVFifoBuffer *f)
 {
     if (f) {
@@ -51,7 +81,7 @@ void av_fifo_reset(AVFifoBuffer *f)
 
 int av_fifo_size(AVFifoBuffer *f)
 {
-    return (uint32_t)(f->wndx - f->rndx);
+    return (uint32_t)(load_index(f, &f->wndx) - load_index(f, &f->rndx));
 }
 
 int av_fifo_space(AVFifoBuffer *f)
@@ -65,7 +95,7 @@ int av_fifo_realloc2(AVFifoBuffer *f, unsigned int new_size)
 
     if (old_size < new_size) {
         int len          = av_fifo_size(f);
-        AVFifoBuffer *f2 = av_fifo_alloc(new_size);
+        AVFifoBuffer *f2 = av_fifo_alloc2(new_size, f->flags);
 
         if (!f2)
             return -1;
@@ -94,12 +124,8 @@ int av_fifo_generic_write(AVFifoBuffer *f, void *src, int size,
             memcpy(f->wptr, src, len);
             src = (uint8_t *)src + len;
         }
-// Write memory barrier needed for SMP here in theory
-        f->wptr += len;
-        if (f->wptr >= f->end)
-            f->wptr = f->buffer;
-        f->wndx += len;
-        size    -= len;
+        av_fifo_commit(f, len);
+        size -= len;
     } while (size > 0);
     return total - size;
 }
@@ -107,7 +133,6 @@ int av_fifo_generic_write(AVFifoBuffer *f, void *src, int size,
 int av_fifo_generic_read(AVFifoBuffer *f, void *dest, int buf_size,
                          void (*func)(void *, void *, int))
 {
-// Read memory barrier needed for SMP here in theory
     do {
         int len = FFMIN(f->end - f->rptr, buf_size);
         if (func)
@@ -116,7 +141,6 @@ int av_fifo_generic_read(AVFifoBuffer *f, void *dest, int buf_size,
             memcpy(dest, f->rptr, len);
             dest = (uint8_t *)dest + len;
         }
-// memory barrier needed for SMP here in theory
         av_fifo_drain(f, len);
         buf_size -= len;
     } while (buf_size > 0);
@@ -129,11 +153,33 @@ void av_fifo_drain(AVFifoBuffer *f, int size)
     f->rptr += size;
     if (f->rptr >= f->end)
         f->rptr -= f->end - f->buffer;
-    f->rndx += size;
+    store_index(f, &f->rndx, f->rndx + size);
+}
+
+int av_fifo_read_window(AVFifoBuffer *f, uint8_t **ptr)
+{
+    *ptr = f->rptr;
+    return FFMIN(f->end - f->rptr, av_fifo_size(f));
+}
+
+int av_fifo_write_window(AVFifoBuffer *f, uint8_t **ptr)
+{
+    *ptr = f->wptr;
+    return FFMIN(f->end - f->wptr, av_fifo_space(f));
+}
+
+void av_fifo_commit(AVFifoBuffer *f, int size)
+{
+    f->wptr += size;
+    if (f->wptr >= f->end)
+        f->wptr -= f->end - f->buffer;
+    store_index(f, &f->wndx, f->wndx + size);
 }
 
 #ifdef TEST
 
+#include "intreadwrite.h"
+
 int main(void)
 {
     /* create a FIFO buffer */
@@ -159,6 +205,27 @@ int main(void)
     }
     printf("\n");
 
+    /* fill and empty the FIFO in place, across the wraparound */
+    for (n = 0, i = 0; n < 3; n++) {
+        uint8_t *ptr;
+        int len;
+
+        while ((len = av_fifo_write_window(fifo, &ptr)) >= sizeof(int)) {
+            for (j = 0; j < len / sizeof(int); j++)
+                AV_WN32(ptr + j * sizeof(int), i++);
+            av_fifo_commit(fifo, j * sizeof(int));
+        }
+        while ((len = av_fifo_read_window(fifo, &ptr)) >= sizeof(int)) {
+            for (j = 0; j < len / sizeof(int); j++)
+                printf("%d ", AV_RN32(ptr + j * sizeof(int)));
+            av_fifo_drain(fifo, j * sizeof(int));
+        }
+        printf("\n");
+        av_fifo_generic_write(fifo, &i, sizeof(int), NULL);
+        av_fifo_generic_read(fifo, &j, sizeof(int), NULL);
+        i++;
+    }
+
     av_fifo_free(fifo);
 
     return 0;
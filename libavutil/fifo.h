@@ -32,8 +32,21 @@ typedef struct AVFifoBuffer {
     uint8_t *buffer;
     uint8_t *rptr, *wptr, *end;
     uint32_t rndx, wndx;
+    int flags;
 } AVFifoBuffer;
 
+/**
+ * The FIFO is shared between exactly one producer thread and one consumer
+ * thread. The read and write positions are then published with memory
+ * barriers, so that the reading functions (av_fifo_size(),
+ * av_fifo_generic_read(), av_fifo_read_window(), av_fifo_drain()) may be
+ * called from one thread concurrently with the writing functions
+ * (av_fifo_space(), av_fifo_generic_write(), av_fifo_write_window(),
+ * av_fifo_commit()) from another one, without any additional locking.
+ * av_fifo_reset() and av_fifo_realloc2() still require exclusive access.
+ */
+#define AV_FIFO_FLAG_SPSC 0x0001
+
 /**
  * Initialize an AVFifoBuffer.
  * @param size of FIFO
@@ -41,6 +54,14 @@ typedef struct AVFifoBuffer {
  */
 AVFifoBuffer *av_fifo_alloc(unsigned int size);
 
+/**
+ * Initialize an AVFifoBuffer with the given flags.
+ * @param size of FIFO
+ * @param flags a combination of AV_FIFO_FLAG_*
+ * @return AVFifoBuffer or NULL in case of memory allocation failure
+ */
+AVFifoBuffer *av_fifo_alloc2(unsigned int size, int flags);
+
 /**
  * Free an AVFifoBuffer.
  * @param f AVFifoBuffer to free
@@ -108,6 +129,41 @@ int av_fifo_realloc2(AVFifoBuffer *f, unsigned int size);
  */
 void av_fifo_drain(AVFifoBuffer *f, int size);
 
+/**
+ * Get direct access to the data at the read end of an AVFifoBuffer.
+ *
+ * The returned region is contiguous, so it may be shorter than
+ * av_fifo_size() when the stored data wraps around the end of the buffer.
+ * Once the caller is done with the data, it must be released with
+ * av_fifo_drain().
+ *
+ * @param f   AVFifoBuffer to read from
+ * @param ptr set to the start of the readable region
+ * @return the number of bytes that can be read from *ptr
+ */
+int av_fifo_read_window(AVFifoBuffer *f, uint8_t **ptr);
+
+/**
+ * Get direct access to the free space at the write end of an AVFifoBuffer.
+ *
+ * The returned region is contiguous, so it may be shorter than
+ * av_fifo_space() when the free space wraps around the end of the buffer.
+ * Data written there is added to the FIFO by av_fifo_commit().
+ *
+ * @param f   AVFifoBuffer to write to
+ * @param ptr set to the start of the writable region
+ * @return the number of bytes that can be written to *ptr
+ */
+int av_fifo_write_window(AVFifoBuffer *f, uint8_t **ptr);
+
+/**
+ * Add data written through av_fifo_write_window() to an AVFifoBuffer.
+ * @param f    AVFifoBuffer to commit to
+ * @param size number of bytes to commit, must not exceed the size returned
+ *             by the last av_fifo_write_window() call
+ */
+void av_fifo_commit(AVFifoBuffer *f, int size);
+
 /**
  * Return a pointer to the data stored in a FIFO buffer at a certain offset.
  * The FIFO buffer is not modified.
@@ -31,7 +31,10 @@
  */
 
 #include <stdint.h>
+#include <string.h>
+
 #include "bswap.h"
+#include "common.h"
 #include "intreadwrite.h"
 #include "md5.h"
 #include "mem.h"
@@ -94,41 +97,45 @@ static const uint32_t T[64] = { // T[i]= fabs(sin(i+1)<<32)
         a = b + (a << t | a >> (32 - t));                               \
     } while (0)
 
-static void body(uint32_t ABCD[4], uint32_t X[16])
+static void body(uint32_t ABCD[4], const uint8_t *src, int nblocks)
 {
     int t;
     int i av_unused;
-    unsigned int a = ABCD[3];
-    unsigned int b = ABCD[2];
-    unsigned int c = ABCD[1];
-    unsigned int d = ABCD[0];
+    int n;
+    unsigned int a, b, c, d;
+    uint32_t X[16];
 
-#if HAVE_BIGENDIAN
-    for (i = 0; i < 16; i++)
-        X[i] = av_bswap32(X[i]);
-#endif
+    for (n = 0; n < nblocks; n++, src += 64) {
+        a = ABCD[3];
+        b = ABCD[2];
+        c = ABCD[1];
+        d = ABCD[0];
+
+        for (i = 0; i < 16; i++)
+            X[i] = AV_RL32(src + 4 * i);
 
 #if CONFIG_SMALL
-    for (i = 0; i < 64; i++) {
-        CORE(i, a, b, c, d);
-        t = d;
-        d = c;
-        c = b;
-        b = a;
-        a = t;
-    }
+        for (i = 0; i < 64; i++) {
+            CORE(i, a, b, c, d);
+            t = d;
+            d = c;
+            c = b;
+            b = a;
+            a = t;
+        }
 #else
 #define CORE2(i)                                                        \
-    CORE( i,   a,b,c,d); CORE((i+1),d,a,b,c);                           \
-    CORE((i+2),c,d,a,b); CORE((i+3),b,c,d,a)
+        CORE( i,   a,b,c,d); CORE((i+1),d,a,b,c);                       \
+        CORE((i+2),c,d,a,b); CORE((i+3),b,c,d,a)
 #define CORE4(i) CORE2(i); CORE2((i+4)); CORE2((i+8)); CORE2((i+12))
-    CORE4(0); CORE4(16); CORE4(32); CORE4(48);
+        CORE4(0); CORE4(16); CORE4(32); CORE4(48);
 #endif
 
-    ABCD[0] += d;
-    ABCD[1] += c;
-    ABCD[2] += b;
-    ABCD[3] += a;
+        ABCD[0] += d;
+        ABCD[1] += c;
+        ABCD[2] += b;
+        ABCD[3] += a;
+    }
 }
 
 void av_md5_init(AVMD5 *ctx)
@@ -143,18 +150,29 @@ void av_md5_init(AVMD5 *ctx)
 
 void av_md5_update(AVMD5 *ctx, const uint8_t *src, const int len)
 {
-    int i, j;
+    int j, n, left = len;
 
     j = ctx->len & 63;
     ctx->len += len;
 
-    for (i = 0; i < len; i++) {
-        ctx->block[j++] = src[i];
-        if (j == 64) {
-            body(ctx->ABCD, (uint32_t *) ctx->block);
-            j = 0;
-        }
+    if (j) {
+        n = FFMIN(64 - j, left);
+        memcpy(ctx->block + j, src, n);
+        src  += n;
+        left -= n;
+        if (j + n < 64)
+            return;
+        body(ctx->ABCD, ctx->block, 1);
+    }
+
+    /* hash whole blocks straight from the input */
+    n = left >> 6;
+    if (n) {
+        body(ctx->ABCD, src, n);
+        src  += n << 6;
+        left &= 63;
     }
+    memcpy(ctx->block, src, left);
 }
 
 void av_md5_final(AVMD5 *ctx, uint8_t *dst)
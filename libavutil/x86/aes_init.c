@@ -0,0 +1,168 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "config.h"
+
+#include "libavutil/aes_internal.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
+#include "cpu.h"
+#include "asm.h"
+
+#if HAVE_AESNI_INLINE
+
+/* round_key[rounds] is added first, round_key[rounds - 1] to round_key[1]
+ * are applied by the round loop and round_key[0] by the last round. */
+#define AESNI_CRYPT(op)                                                       \
+static av_always_inline void aes ## op ## _x1(const av_aes_block *rk,         \
+                                              int rounds, uint8_t *dst,       \
+                                              const uint8_t *src)             \
+{                                                                             \
+    x86_reg i = 16 * (rounds - 1);                                            \
+    __asm__ volatile (                                                        \
+        "movdqu       (%2), %%xmm0          \n"                               \
+        "pxor     16(%1,%0), %%xmm0         \n"                               \
+        "1:                                 \n"                               \
+        "aes" #op "  (%1,%0), %%xmm0        \n"                               \
+        "sub           $16, %0              \n"                               \
+        "jnz            1b                  \n"                               \
+        "aes" #op "last (%1), %%xmm0        \n"                               \
+        "movdqu      %%xmm0, (%3)           \n"                               \
+        : "+&r"(i)                                                            \
+        : "r"(rk), "r"(src), "r"(dst)                                         \
+        : XMM_CLOBBERS("%xmm0",) "memory"                                     \
+    );                                                                        \
+}                                                                             \
+                                                                              \
+static av_always_inline void aes ## op ## _x4(const av_aes_block *rk,         \
+                                              int rounds, uint8_t *dst,       \
+                                              const uint8_t *src)             \
+{                                                                             \
+    x86_reg i = 16 * (rounds - 1);                                            \
+    __asm__ volatile (                                                        \
+        "movdqa  16(%1,%0), %%xmm4          \n"                               \
+        "movdqu       (%2), %%xmm0          \n"                               \
+        "movdqu     16(%2), %%xmm1          \n"                               \
+        "movdqu     32(%2), %%xmm2          \n"                               \
+        "movdqu     48(%2), %%xmm3          \n"                               \
+        "pxor        %%xmm4, %%xmm0         \n"                               \
+        "pxor        %%xmm4, %%xmm1         \n"                               \
+        "pxor        %%xmm4, %%xmm2         \n"                               \
+        "pxor        %%xmm4, %%xmm3         \n"                               \
+        "1:                                 \n"                               \
+        "movdqa    (%1,%0), %%xmm4          \n"                               \
+        "aes" #op "  %%xmm4, %%xmm0         \n"                               \
+        "aes" #op "  %%xmm4, %%xmm1         \n"                               \
+        "aes" #op "  %%xmm4, %%xmm2         \n"                               \
+        "aes" #op "  %%xmm4, %%xmm3         \n"                               \
+        "sub           $16, %0              \n"                               \
+        "jnz            1b                  \n"                               \
+        "movdqa       (%1), %%xmm4          \n"                               \
+        "aes" #op "last %%xmm4, %%xmm0      \n"                               \
+        "aes" #op "last %%xmm4, %%xmm1      \n"                               \
+        "aes" #op "last %%xmm4, %%xmm2      \n"                               \
+        "aes" #op "last %%xmm4, %%xmm3      \n"                               \
+        "movdqu      %%xmm0,   (%3)         \n"                               \
+        "movdqu      %%xmm1, 16(%3)         \n"                               \
+        "movdqu      %%xmm2, 32(%3)         \n"                               \
+        "movdqu      %%xmm3, 48(%3)         \n"                               \
+        : "+&r"(i)                                                            \
+        : "r"(rk), "r"(src), "r"(dst)                                         \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4",)          \
+          "memory"                                                            \
+    );                                                                        \
+}
+
+AESNI_CRYPT(enc)
+AESNI_CRYPT(dec)
+
+static inline void xor_block(uint8_t *dst, const uint8_t *a, const uint8_t *b)
+{
+    AV_WN64(dst,     AV_RN64(a)     ^ AV_RN64(b));
+    AV_WN64(dst + 8, AV_RN64(a + 8) ^ AV_RN64(b + 8));
+}
+
+static void aes_encrypt_aesni(AVAES *a, uint8_t *dst, const uint8_t *src,
+                              int count, uint8_t *iv, int rounds)
+{
+    if (iv) {
+        /* CBC encryption is inherently serial */
+        for (; count > 0; count--, src += 16, dst += 16) {
+            uint8_t tmp[16];
+            xor_block(tmp, src, iv);
+            aesenc_x1(a->round_key[0], rounds, dst, tmp);
+            memcpy(iv, dst, 16);
+        }
+        return;
+    }
+
+    for (; count >= 4; count -= 4, src += 64, dst += 64)
+        aesenc_x4(a->round_key[0], rounds, dst, src);
+    for (; count > 0; count--, src += 16, dst += 16)
+        aesenc_x1(a->round_key[0], rounds, dst, src);
+}
+
+static void aes_decrypt_aesni(AVAES *a, uint8_t *dst, const uint8_t *src,
+                              int count, uint8_t *iv, int rounds)
+{
+    uint8_t tmp[64], next_iv[16];
+    int i;
+
+    if (!iv) {
+        for (; count >= 4; count -= 4, src += 64, dst += 64)
+            aesdec_x4(a->round_key[1], rounds, dst, src);
+        for (; count > 0; count--, src += 16, dst += 16)
+            aesdec_x1(a->round_key[1], rounds, dst, src);
+        return;
+    }
+
+    /* CBC decryption only chains on the ciphertext, so several blocks can
+     * be in flight at once. The blocks are finished from the last one
+     * backwards, so that src may be equal to dst. */
+    for (; count >= 4; count -= 4, src += 64, dst += 64) {
+        aesdec_x4(a->round_key[1], rounds, tmp, src);
+        memcpy(next_iv, src + 48, 16);
+        for (i = 3; i > 0; i--)
+            xor_block(dst + 16 * i, tmp + 16 * i, src + 16 * (i - 1));
+        xor_block(dst, tmp, iv);
+        memcpy(iv, next_iv, 16);
+    }
+    for (; count > 0; count--, src += 16, dst += 16) {
+        aesdec_x1(a->round_key[1], rounds, tmp, src);
+        memcpy(next_iv, src, 16);
+        xor_block(dst, tmp, iv);
+        memcpy(iv, next_iv, 16);
+    }
+}
+
+#endif /* HAVE_AESNI_INLINE */
+
+av_cold void ff_init_aes_x86(AVAES *a)
+{
+#if HAVE_AESNI_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_AESNI(cpu_flags)) {
+        a->crypt[0] = aes_encrypt_aesni;
+        a->crypt[1] = aes_decrypt_aesni;
+    }
+#endif /* HAVE_AESNI_INLINE */
+}
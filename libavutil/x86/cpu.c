@@ -126,6 +126,14 @@ int ff_get_cpu_flags_x86(void)
             rval |= AV_CPU_FLAG_SSE4;
         if (ecx & 0x00100000 )
             rval |= AV_CPU_FLAG_SSE42;
+#if HAVE_AESNI
+        if (ecx & 0x02000000 )
+            rval |= AV_CPU_FLAG_AESNI;
+#endif /* HAVE_AESNI */
+#if HAVE_PCLMUL
+        if (ecx & 0x00000002 )
+            rval |= AV_CPU_FLAG_PCLMUL;
+#endif /* HAVE_PCLMUL */
 #if HAVE_AVX
         /* Check OXSAVE and AVX bits */
         if ((ecx & 0x18000000) == 0x18000000) {
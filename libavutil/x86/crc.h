@@ -0,0 +1,174 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * CRC helpers using PCLMULQDQ and the SSE4.2 crc32 instruction
+ */
+
+#ifndef AVUTIL_X86_CRC_H
+#define AVUTIL_X86_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+
+#if HAVE_PCLMUL_INLINE
+
+/* Folding constants for the CRC-32 polynomial 0x04C11DB7. Row 0 is the
+ * pshufb mask bringing a 16-byte block into polynomial order, rows 1-4
+ * fold a block forward by 512, 384, 256 and 128 bits. The LE (reflected)
+ * rows hold x^(d+63) and x^(d-1) mod P bit-reversed, the BE rows hold
+ * x^d and x^(d+64) mod P. */
+DECLARE_ALIGNED(16, static const uint64_t, crc32_fold_consts)[2][5][2] = {
+    {   /* AV_CRC_32_IEEE */
+        { 0x08090A0B0C0D0E0F, 0x0001020304050607 },
+        { 0x00000000E6228B11, 0x000000008833794C },
+        { 0x000000008C3828A8, 0x0000000064BF7A9B },
+        { 0x0000000075BE46B7, 0x00000000569700E5 },
+        { 0x00000000E8A45605, 0x00000000C5B9CD4C },
+    }, {/* AV_CRC_32_IEEE_LE */
+        { 0x0706050403020100, 0x0F0E0D0C0B0A0908 },
+        { 0x653D982200000000, 0xCAD38E8F00000000 },
+        { 0x69CCFC0D00000000, 0x2A28386200000000 },
+        { 0x9570D49500000000, 0x01B5FD1D00000000 },
+        { 0x65673B4600000000, 0x9BA54C6F00000000 },
+    },
+};
+
+#define FOLD(x, k, t)                         \
+    "movdqa    %%"#x", %%"#t"             \n\t" \
+    "pclmulqdq $0x00, "k", %%"#x"         \n\t" \
+    "pclmulqdq $0x11, "k", %%"#t"         \n\t" \
+    "pxor      %%"#t", %%"#x"             \n\t"
+
+#define FOLD_LOAD(x, off)                     \
+    FOLD(x, "%%xmm6", xmm4)                   \
+    "movdqu  "#off"(%0), %%xmm5           \n\t" \
+    "pshufb    %%xmm7, %%xmm5             \n\t" \
+    "pxor      %%xmm5, %%"#x"             \n\t"
+
+/**
+ * Fold a buffer of at least 64 bytes down to a 16-byte block with the same
+ * CRC-32, starting from crc. All whole 16-byte blocks are consumed.
+ *
+ * @param le  1 for AV_CRC_32_IEEE_LE, 0 for AV_CRC_32_IEEE
+ * @param rem receives the folded block, whose CRC computed from 0 and
+ *            continued over the returned tail is the CRC of the buffer
+ * @return    the unprocessed tail, *length is updated to its size
+ */
+static inline const uint8_t *crc32_fold_pclmul(int le, uint32_t crc,
+                                               const uint8_t *buffer,
+                                               size_t *length, uint8_t *rem)
+{
+    size_t len = *length;
+
+    __asm__ volatile (
+        "movdqa      (%3), %%xmm7         \n\t"
+        "movd        %4,   %%xmm4         \n\t"
+        "movdqu      (%0), %%xmm0         \n\t"
+        "movdqu    16(%0), %%xmm1         \n\t"
+        "movdqu    32(%0), %%xmm2         \n\t"
+        "movdqu    48(%0), %%xmm3         \n\t"
+        "pxor      %%xmm4, %%xmm0         \n\t"
+        "pshufb    %%xmm7, %%xmm0         \n\t"
+        "pshufb    %%xmm7, %%xmm1         \n\t"
+        "pshufb    %%xmm7, %%xmm2         \n\t"
+        "pshufb    %%xmm7, %%xmm3         \n\t"
+        "add       $64, %0                \n\t"
+        "sub       $64, %1                \n\t"
+        "movdqa    16(%3), %%xmm6         \n\t"
+        "cmp       $64, %1                \n\t"
+        "jb        2f                     \n\t"
+        "1:                               \n\t"
+        FOLD_LOAD(xmm0,  0)
+        FOLD_LOAD(xmm1, 16)
+        FOLD_LOAD(xmm2, 32)
+        FOLD_LOAD(xmm3, 48)
+        "add       $64, %0                \n\t"
+        "sub       $64, %1                \n\t"
+        "cmp       $64, %1                \n\t"
+        "jae       1b                     \n\t"
+        "2:                               \n\t"
+        FOLD(xmm0, "32(%3)", xmm4)
+        FOLD(xmm1, "48(%3)", xmm5)
+        "movdqa    64(%3), %%xmm6         \n\t"
+        FOLD(xmm2, "%%xmm6", xmm4)
+        "pxor      %%xmm0, %%xmm3         \n\t"
+        "pxor      %%xmm1, %%xmm3         \n\t"
+        "pxor      %%xmm2, %%xmm3         \n\t"
+        "cmp       $16, %1                \n\t"
+        "jb        4f                     \n\t"
+        "3:                               \n\t"
+        FOLD_LOAD(xmm3, 0)
+        "add       $16, %0                \n\t"
+        "sub       $16, %1                \n\t"
+        "cmp       $16, %1                \n\t"
+        "jae       3b                     \n\t"
+        "4:                               \n\t"
+        "pshufb    %%xmm7, %%xmm3         \n\t"
+        "movdqu    %%xmm3, (%2)           \n\t"
+        : "+r"(buffer), "+r"(len)
+        : "r"(rem), "r"(crc32_fold_consts[le]), "rm"(crc)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+
+    *length = len;
+    return buffer;
+}
+
+#undef FOLD
+#undef FOLD_LOAD
+
+#endif /* HAVE_PCLMUL_INLINE */
+
+#if HAVE_SSE42_INLINE
+
+/**
+ * Compute the AV_CRC_32C checksum with the SSE4.2 crc32 instruction, which
+ * implements exactly that polynomial.
+ */
+static inline uint32_t crc32c_sse42(uint32_t crc, const uint8_t *buffer,
+                                    size_t length)
+{
+    const uint8_t *end = buffer + length;
+#if ARCH_X86_64
+    uint64_t crc64 = crc;
+
+    for (; end - buffer >= 8; buffer += 8)
+        __asm__ ("crc32q %1, %0" : "+r"(crc64) : "rm"(AV_RN64(buffer)));
+    crc = crc64;
+#else
+    for (; end - buffer >= 4; buffer += 4)
+        __asm__ ("crc32l %1, %0" : "+r"(crc) : "rm"(AV_RN32(buffer)));
+#endif
+    for (; buffer < end; buffer++)
+        __asm__ ("crc32b %1, %0" : "+r"(crc) : "qm"(*buffer));
+
+    return crc;
+}
+
+#endif /* HAVE_SSE42_INLINE */
+
+#endif /* AVUTIL_X86_CRC_H */
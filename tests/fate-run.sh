@@ -146,6 +146,22 @@ enc_dec(){
     tests/tiny_psnr $srcfile $decfile $cmp_unit $cmp_shift
 }
 
+# remux a raw H.264 stream to MP4, convert it back with h264_mp4toannexb
+# and decode the result
+h264_mp4toannexb(){
+    srcfile=$1
+    shift
+    mp4file="${outdir}/${test}.mp4"
+    annexbfile="${outdir}/${test}.h264"
+    cleanfiles="$cleanfiles $mp4file $annexbfile"
+    tmp4file=$(target_path $mp4file)
+    tannexbfile=$(target_path $annexbfile)
+    avconv -i $srcfile -c copy -f mp4 -y $tmp4file || return
+    avconv -i $tmp4file -c copy -bsf h264_mp4toannexb -f h264 \
+        -y $tannexbfile || return
+    framecrc "$@" -i $tannexbfile
+}
+
 lavftest(){
     t="${test#lavf-}"
     ref=${base}/ref/lavf/$t
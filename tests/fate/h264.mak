@@ -177,7 +177,30 @@ FATE_H264_REINIT_TESTS := large_420_8-to-small_420_8                    \
                           small_420_9-to-small_420_8                    \
                           small_422_9-to-small_420_9                    \
 
+# decoded with slice threads, compared with the single-threaded output
+FATE_H264_SLICE_THREADS := ba1_ft_c                                     \
+                           caba3_toshiba_e                              \
+                           ci1_ft_b                                     \
+                           frext-hpcv_brcm_a                            \
+                           sl1_sva_b                                    \
+
+# decoded with many more frame threads than reference frames in flight
+FATE_H264_FRAME_THREADS := cabref3_sand_d                               \
+                           cama3_sand_e                                 \
+                           cvfi1_sony_d                                 \
+                           frext-frext_mmco4_sony_b                     \
+                           mr9_bt_b                                     \
+
+# decoded with frame and slice threads, without and with a bounded delay
+FATE_H264_FRAME_SLICE_THREADS := ba1_ft_c                               \
+                                 cabref3_sand_d                         \
+                                 cama3_sand_e                           \
+
 FATE_H264  := $(FATE_H264:%=fate-h264-conformance-%)                    \
+              $(FATE_H264_FRAME_SLICE_THREADS:%=fate-h264-frame-slice-threads-%) \
+              $(FATE_H264_FRAME_SLICE_THREADS:%=fate-h264-thread-delay-%) \
+              $(FATE_H264_FRAME_THREADS:%=fate-h264-frame-threads-%)    \
+              $(FATE_H264_SLICE_THREADS:%=fate-h264-slice-threads-%)    \
               $(FATE_H264_REINIT_TESTS:%=fate-h264-reinit-%)            \
               fate-h264-extreme-plane-pred                              \
               fate-h264-lossless                                        \
@@ -187,6 +210,14 @@ FATE_H264-$(call DEMDEC,  MOV, H264) += fate-h264-crop-to-container
 FATE_H264-$(call DEMDEC,  MOV, H264) += fate-h264-interlace-crop
 FATE_H264-$(call ALLYES, MOV_DEMUXER H264_MP4TOANNEXB_BSF) += fate-h264-bsf-mp4toannexb
 
+# remuxed to MP4 and back to Annex B, compared with the direct decoding
+FATE_H264_MP4TOANNEXB := ba_mw_d                                        \
+                         caba3_sva_b                                    \
+                         frext-hpcv_brcm_a                              \
+
+FATE_H264-$(call ALLYES, H264_DEMUXER H264_MUXER MOV_DEMUXER MP4_MUXER \
+                         H264_MP4TOANNEXB_BSF H264_DECODER) += $(FATE_H264_MP4TOANNEXB:%=fate-h264-mp4toannexb-%)
+
 FATE_SAMPLES_AVCONV += $(FATE_H264-yes)
 fate-h264: $(FATE_H264-yes)
 
@@ -365,9 +396,46 @@ fate-h264-conformance-sva_nl1_b:                  CMD = framecrc -i $(TARGET_SAM
 fate-h264-conformance-sva_nl2_e:                  CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/SVA_NL2_E.264
 
 fate-h264-bsf-mp4toannexb:                        CMD = md5 -i $(TARGET_SAMPLES)/h264/interlaced_crop.mp4 -vcodec copy -bsf h264_mp4toannexb -f h264
+fate-h264-mp4toannexb-ba_mw_d:                    CMD = h264_mp4toannexb $(TARGET_SAMPLES)/h264-conformance/BA_MW_D.264
+fate-h264-mp4toannexb-caba3_sva_b:                CMD = h264_mp4toannexb $(TARGET_SAMPLES)/h264-conformance/CABA3_SVA_B.264
+fate-h264-mp4toannexb-frext-hpcv_brcm_a:          CMD = h264_mp4toannexb $(TARGET_SAMPLES)/h264-conformance/FRext/HPCV_BRCM_A.264
+fate-h264-mp4toannexb-%: REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(@:fate-h264-mp4toannexb-%=%)
 fate-h264-crop-to-container:                      CMD = framemd5 -i $(TARGET_SAMPLES)/h264/crop-to-container-dims-canon.mov
 fate-h264-extreme-plane-pred:                     CMD = framemd5 -i $(TARGET_SAMPLES)/h264/extreme-plane-pred.h264
 fate-h264-interlace-crop:                         CMD = framecrc -i $(TARGET_SAMPLES)/h264/interlaced_crop.mp4 -vframes 3
 fate-h264-lossless:                               CMD = framecrc -i $(TARGET_SAMPLES)/h264/lossless.h264
 
+fate-h264-frame-threads-cabref3_sand_d:           CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/CABREF3_Sand_D.264
+fate-h264-frame-threads-cama3_sand_e:             CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/CAMA3_Sand_E.264
+fate-h264-frame-threads-cvfi1_sony_d:             CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/CVFI1_Sony_D.jsv
+fate-h264-frame-threads-frext-frext_mmco4_sony_b: CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/FRext/FRExt_MMCO4_Sony_B.264
+fate-h264-frame-threads-mr9_bt_b:                 CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/MR9_BT_B.h264
+
+fate-h264-frame-threads-%: THREADS     = 16
+fate-h264-frame-threads-%: THREAD_TYPE = frame
+fate-h264-frame-threads-%: REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(@:fate-h264-frame-threads-%=%)
+
+fate-h264-frame-slice-threads-ba1_ft_c:           CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/BA1_FT_C.264
+fate-h264-frame-slice-threads-cabref3_sand_d:     CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/CABREF3_Sand_D.264
+fate-h264-frame-slice-threads-cama3_sand_e:       CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/CAMA3_Sand_E.264
+
+fate-h264-thread-delay-ba1_ft_c:                  CMD = framecrc -frame_thread_delay 1 -i $(TARGET_SAMPLES)/h264-conformance/BA1_FT_C.264
+fate-h264-thread-delay-cabref3_sand_d:            CMD = framecrc -frame_thread_delay 1 -i $(TARGET_SAMPLES)/h264-conformance/CABREF3_Sand_D.264
+fate-h264-thread-delay-cama3_sand_e:              CMD = framecrc -frame_thread_delay 1 -i $(TARGET_SAMPLES)/h264-conformance/CAMA3_Sand_E.264
+
+fate-h264-frame-slice-threads-% fate-h264-thread-delay-%: THREADS     = 8
+fate-h264-frame-slice-threads-% fate-h264-thread-delay-%: THREAD_TYPE = frame+slice
+fate-h264-frame-slice-threads-%: REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(@:fate-h264-frame-slice-threads-%=%)
+fate-h264-thread-delay-%: REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(@:fate-h264-thread-delay-%=%)
+
+fate-h264-slice-threads-ba1_ft_c:                 CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/BA1_FT_C.264
+fate-h264-slice-threads-caba3_toshiba_e:          CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/CABA3_TOSHIBA_E.264
+fate-h264-slice-threads-ci1_ft_b:                 CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/CI1_FT_B.264
+fate-h264-slice-threads-frext-hpcv_brcm_a:        CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/FRext/HPCV_BRCM_A.264
+fate-h264-slice-threads-sl1_sva_b:                CMD = framecrc -i $(TARGET_SAMPLES)/h264-conformance/SL1_SVA_B.264
+
+fate-h264-slice-threads-%: THREADS     = 4
+fate-h264-slice-threads-%: THREAD_TYPE = slice
+fate-h264-slice-threads-%: REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(@:fate-h264-slice-threads-%=%)
+
 fate-h264-reinit-%:                               CMD = framecrc -i $(TARGET_SAMPLES)/h264/$(@:fate-h264-%=%).h264 -vf format=yuv444p10le,scale=w=352:h=288
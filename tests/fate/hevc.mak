@@ -155,8 +155,19 @@ endef
 $(foreach N,$(HEVC_SAMPLES),$(eval $(call FATE_HEVC_TEST,$(N))))
 $(foreach N,$(HEVC_SAMPLES_10BIT),$(eval $(call FATE_HEVC_TEST_10BIT,$(N))))
 
+# decoded again from the start after a flush and after a reset half way
+HEVC_SAMPLES_RESET =            \
+    RPS_A_docomo_4              \
+    WPP_A_ericsson_MAIN10_2     \
+
+FATE_HEVC_RESET-$(call ALLYES, HEVC_DECODER HEVC_PARSER) += $(HEVC_SAMPLES_RESET:%=fate-hevc-reset-%)
+
+fate-hevc-reset-%: libavcodec/reset-test$(EXESUF)
+fate-hevc-reset-%: CMD = run libavcodec/reset-test hevc $(TARGET_SAMPLES)/hevc-conformance/$(@:fate-hevc-reset-%=%).bit
+
 FATE_HEVC-$(call DEMDEC, HEVC, HEVC) += $(FATE_HEVC)
 
 FATE_SAMPLES_AVCONV += $(FATE_HEVC-yes)
+FATE_SAMPLES        += $(FATE_HEVC_RESET-yes)
 
-fate-hevc: $(FATE_HEVC-yes)
+fate-hevc: $(FATE_HEVC-yes) $(FATE_HEVC_RESET-yes)
@@ -19,5 +19,10 @@ fate-rangecoder: CMD = run libavcodec/rangecoder-test
 fate-rangecoder: CMP = null
 fate-rangecoder: REF = /dev/null
 
+FATE_LIBAVCODEC-$(call ALLYES, MPEG4_ENCODER MPEG4_DECODER MP2_ENCODER \
+                               MP2_DECODER AAC_DECODER H264_DECODER) += fate-avcodec-reset
+fate-avcodec-reset: libavcodec/reset-test$(EXESUF)
+fate-avcodec-reset: CMD = run libavcodec/reset-test
+
 FATE-$(CONFIG_AVCODEC) += $(FATE_LIBAVCODEC-yes)
 fate-libavcodec: $(FATE_LIBAVCODEC-yes)
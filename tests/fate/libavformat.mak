@@ -1,3 +1,11 @@
+FATE_LIBAVFORMAT-yes += fate-interleave
+fate-interleave: libavformat/interleave-test$(EXESUF)
+fate-interleave: CMD = run libavformat/interleave-test
+
+FATE_LIBAVFORMAT-$(call ALLYES, NUT_MUXER NUT_DEMUXER) += fate-layout
+fate-layout: libavformat/layout-test$(EXESUF)
+fate-layout: CMD = run libavformat/layout-test
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/noproxy-test$(EXESUF)
 fate-noproxy: CMD = run libavformat/noproxy-test
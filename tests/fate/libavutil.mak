@@ -25,6 +25,10 @@ FATE_LIBAVUTIL += fate-blowfish
 fate-blowfish: libavutil/blowfish-test$(EXESUF)
 fate-blowfish: CMD = run libavutil/blowfish-test
 
+FATE_LIBAVUTIL += fate-buffer
+fate-buffer: libavutil/buffer-test$(EXESUF)
+fate-buffer: CMD = run libavutil/buffer-test
+
 FATE_LIBAVUTIL += fate-crc
 fate-crc: libavutil/crc-test$(EXESUF)
 fate-crc: CMD = run libavutil/crc-test
@@ -131,6 +131,9 @@ fate-vsynth%-mpeg2-ivlc-qprd:    ENCOPTS = -b:v 500k                    \
                                            -mbd rd
 fate-vsynth%-mpeg2-thread:       ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
                                            -threads 2 -slices 2
+
+fate-vsynth%-mpeg4-thread-rows:  ENCOPTS = -b 400k -bf 2 -mbd rd -mepc 128 \
+                                           -threads 3 -slices 1
 fate-vsynth%-mpeg2-thread-ivlc:  ENCOPTS = -qscale 10 -bf 2 -flags +ildct+ilme \
                                            -intra_vlc 1 -threads 2 -slices 2
 
@@ -141,11 +144,14 @@ FATE_MPEG4_AVI = mpeg4-rc                                               \
                  mpeg4-adap                                             \
                  mpeg4-qpel                                             \
                  mpeg4-thread                                           \
+                 mpeg4-thread-rows                                      \
                  mpeg4-error                                            \
                  mpeg4-nr
 
 FATE_VCODEC-$(call ENCDEC, MPEG4, MP4 MOV) += $(FATE_MPEG4_MP4)
 FATE_VCODEC-$(call ENCDEC, MPEG4, AVI)     += $(FATE_MPEG4_AVI)
+FATE_VCODEC-$(call ALLYES, MPEG4_ENCODER MPEG4_DECODER AVI_MUXER AVI_DEMUXER \
+                          FADE_FILTER) += mpeg4-lookahead
 
 fate-vsynth%-mpeg4:              ENCOPTS = -qscale 10 -flags +mv4 -mbd bits
 fate-vsynth%-mpeg4:              FMT     = mp4
@@ -164,6 +170,10 @@ fate-vsynth%-mpeg4-error:        ENCOPTS = -qscale 7 -flags +mv4+aic    \
 
 fate-vsynth%-mpeg4-nr:           ENCOPTS = -qscale 8 -flags +mv4 -mbd rd -nr 200
 
+# a hard cut from black at frame 10, in the middle of a B-frame run
+fate-vsynth%-mpeg4-lookahead:    ENCOPTS = -vf fade=in:10:1 -b 400k -bf 3 \
+                                           -lookahead 2
+
 fate-vsynth%-mpeg4-qpel:         ENCOPTS = -qscale 7 -flags +mv4+qpel -mbd 2 \
                                            -bf 2 -cmp 1 -subcmp 2
 
@@ -178,16 +188,23 @@ fate-vsynth%-mpeg4-thread:       ENCOPTS = -b 500k -flags +mv4+aic         \
                                            -mbd bits -ps 200 -bf 2         \
                                            -threads 2 -slices 2
 
+fate-vsynth%-mpeg4-thread-rows:  ENCOPTS = -b 400k -bf 2 -mbd rd -mepc 128 \
+                                           -threads 3 -slices 1
+
 FATE_VCODEC-$(call ENCDEC, MSMPEG4V3, AVI) += msmpeg4
 fate-vsynth%-msmpeg4:            ENCOPTS = -qscale 10
 
 FATE_VCODEC-$(call ENCDEC, MSMPEG4V2, AVI) += msmpeg4v2
 fate-vsynth%-msmpeg4v2:          ENCOPTS = -qscale 10
 
-FATE_VCODEC-$(call ENCDEC, PRORES, MOV) += prores
+FATE_VCODEC-$(call ENCDEC, PRORES, MOV) += prores prores-thread
 fate-vsynth%-prores:             ENCOPTS = -profile hq
 fate-vsynth%-prores:             FMT     = mov
 
+fate-vsynth%-prores-thread:      ENCOPTS = -profile hq -threads 4 \
+                                           -thread_type frame
+fate-vsynth%-prores-thread:      FMT     = mov
+
 FATE_VCODEC-$(call ENCDEC, QTRLE, MOV)  += qtrle
 fate-vsynth%-qtrle:              FMT     = mov
 
@@ -0,0 +1,185 @@
+/*
+ * This file is part of Libav.
+ *
+ * Libav is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * Libav is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with Libav; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Load test for an HTTP server such as avserver. A number of idle
+ * connections are opened and left in the middle of a request, then
+ * complete requests are issued one after the other for a given time.
+ * With the server's pid, the server CPU time per request is reported,
+ * as read from /proc/<pid>/stat.
+ */
+
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-i idleconns] [-d duration] [-p serverpid] "
+            "host port [path]\n", argv0);
+    return ret;
+}
+
+/* server user + system CPU time in microseconds, or -1 if unknown */
+static int64_t server_cpu_time(int pid)
+{
+    char name[32], buf[1024], *p;
+    unsigned long utime, stime;
+    FILE *f;
+    int n;
+
+    if (!pid)
+        return -1;
+    snprintf(name, sizeof(name), "/proc/%d/stat", pid);
+    if (!(f = fopen(name, "r")))
+        return -1;
+    n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = 0;
+    /* the command name may contain spaces, the fields after it may not */
+    if (!(p = strrchr(buf, ')')) ||
+        sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+               &utime, &stime) != 2)
+        return -1;
+    return (int64_t)(utime + stime) * 1000000 / sysconf(_SC_CLK_TCK);
+}
+
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int connect_server(const struct addrinfo *ai, const char *data)
+{
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+
+    if (fd < 0)
+        return -1;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) < 0 ||
+        send(fd, data, strlen(data), 0) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* send a complete request and read the reply until the server closes */
+static int request(const struct addrinfo *ai, const char *req)
+{
+    char buf[4096];
+    int fd, ret;
+
+    if ((fd = connect_server(ai, req)) < 0)
+        return -1;
+    while ((ret = recv(fd, buf, sizeof(buf), 0)) > 0)
+        ;
+    close(fd);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_idle = 0, duration = 5, pid = 0, n = 0, ret = 1, i;
+    const char *host = NULL, *port = NULL, *path = "/";
+    struct addrinfo hints = { 0 }, *ai = NULL;
+    char req[1024];
+    int *idle = NULL;
+    int64_t start_time, elapsed, cpu0, cpu1;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            nb_idle = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+            duration = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            pid = atoi(argv[++i]);
+        } else if (!host) {
+            host = argv[i];
+        } else if (!port) {
+            port = argv[i];
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!port || nb_idle < 0 || duration <= 0)
+        return usage(argv[0], 1);
+
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((i = getaddrinfo(host, port, &hints, &ai))) {
+        fprintf(stderr, "Unable to resolve %s: %s\n", host, gai_strerror(i));
+        return 1;
+    }
+    snprintf(req, sizeof(req), "GET %s HTTP/1.0\r\n\r\n", path);
+
+    if (nb_idle && !(idle = malloc(nb_idle * sizeof(*idle)))) {
+        fprintf(stderr, "Out of memory\n");
+        nb_idle = 0;
+        goto end;
+    }
+    for (i = 0; i < nb_idle; i++) {
+        /* an unfinished request line keeps the connection waiting */
+        if ((idle[i] = connect_server(ai, "GET /")) < 0) {
+            perror("Idle connection");
+            nb_idle = i;
+            goto end;
+        }
+        /* avserver listens with a backlog of 5; give it time to accept
+         * when client and server share a CPU, instead of having further
+         * SYNs dropped and retried a second later */
+        if (i % 4 == 3)
+            usleep(1000);
+    }
+    /* let the server accept the idle connections before measuring */
+    usleep(500 * 1000);
+
+    cpu0       = server_cpu_time(pid);
+    start_time = gettime();
+    do {
+        if (request(ai, req) < 0) {
+            perror("Request");
+            goto end;
+        }
+        n++;
+        elapsed = gettime() - start_time;
+    } while (elapsed < duration * 1000000LL);
+    cpu1 = server_cpu_time(pid);
+
+    printf("idle %d requests %d req/s %.1f", nb_idle, n,
+           n * 1000000.0 / elapsed);
+    if (cpu0 >= 0 && cpu1 >= 0)
+        printf(" server cpu us/req %.1f req per cpu second %.1f",
+               (double)(cpu1 - cpu0) / n,
+               cpu1 > cpu0 ? n * 1000000.0 / (cpu1 - cpu0) : 0.0);
+    printf("\n");
+    ret = 0;
+
+end:
+    for (i = 0; i < nb_idle; i++)
+        close(idle[i]);
+    free(idle);
+    freeaddrinfo(ai);
+    return ret;
+}